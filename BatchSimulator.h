@@ -0,0 +1,275 @@
+#ifndef BATCH_SIMULATOR_H
+#define BATCH_SIMULATOR_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <random>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "FacilityGame.h"
+#include "FacilityGameException.h"
+#include "enums.h"
+
+// the rules of the simple players, which only depend on the board, so the
+// simulator plays them without the player objects
+enum class BatchPolicy { LINEAR, RANDOM, HIGHEST };
+
+inline std::optional<BatchPolicy> batch_policy(std::string_view name) {
+  if (name == "Linear") {
+    return BatchPolicy::LINEAR;
+  }
+  if (name == "Random") {
+    return BatchPolicy::RANDOM;
+  }
+  if (name == "Highest") {
+    return BatchPolicy::HIGHEST;
+  }
+  return std::nullopt;
+}
+
+// Plays a batch of games on boards of the same size, one seed each, between
+// two of the simple policies. The games are stored as structures of arrays:
+// the node values, the statuses and the move orders of all the games are in
+// a few flat buffers, one row per game, which are reused by reset(), so a
+// batch allocates nothing once it has been sized. Every step plays one ply
+// of all the unfinished games, with one loop per kernel: choosing the moves
+// of a policy, applying them with the blocking of the neighbors, and at the
+// end scoring every row for both players in one pass.
+//
+// The policies play exactly like FPlayerLinear, FPlayerRandom and
+// FPlayerHighest. A node never becomes FREE again, so each of them keeps a
+// cursor per game which only moves forward: the first free node, the first
+// free node in the scan order of FPlayerRandom, and the first free node in
+// the order by decreasing value, then increasing index.
+class BatchSimulator {
+private:
+  using node_t = FacilityGame::node_t;
+  using status_t = std::uint8_t;
+
+  static constexpr auto FREE = static_cast<status_t>(FacilityStatus::FREE);
+  static constexpr auto BLOCKED =
+      static_cast<status_t>(FacilityStatus::BLOCKED);
+  static constexpr auto PLAYER_A =
+      static_cast<status_t>(FacilityStatus::PLAYER_A);
+  static constexpr auto PLAYER_B =
+      static_cast<status_t>(FacilityStatus::PLAYER_B);
+
+  std::size_t m_size;
+  std::size_t m_count;
+  std::vector<node_t> m_nodes;
+  std::vector<status_t> m_statuses;
+  std::vector<std::size_t> m_num_free;
+  std::vector<std::size_t> m_moves;
+  // the cursors of the policies, and their orders where needed
+  std::vector<std::size_t> m_linear;
+  std::vector<std::size_t> m_random;
+  std::vector<std::size_t> m_random_start;
+  std::vector<bool> m_random_forward;
+  std::vector<std::size_t> m_highest;
+  std::vector<std::uint32_t> m_highest_order;
+  std::vector<std::size_t> m_score_a;
+  std::vector<std::size_t> m_score_b;
+  // FPlayerRandom seeds its generator with the value of the first node, so
+  // its start and direction are computed once for every value; seeding a
+  // std::mt19937 costs as much as a whole small game
+  std::array<std::size_t, MAX_VALUE + 1> m_random_starts{};
+  std::array<bool, MAX_VALUE + 1> m_random_forwards{};
+
+  [[nodiscard]] std::span<status_t const> statuses(std::size_t game) const {
+    return {m_statuses.data() + game * m_size, m_size};
+  }
+
+  [[nodiscard]] std::span<node_t const> nodes(std::size_t game) const {
+    return {m_nodes.data() + game * m_size, m_size};
+  }
+
+  // the node FPlayerRandom visits k-th
+  [[nodiscard]] std::size_t random_node(std::size_t game, std::size_t k) const {
+    std::size_t const start = m_random_start[game];
+    return m_random_forward[game] ? (start + k) % m_size
+                                  : (m_size + start - k) % m_size;
+  }
+
+  void choose_moves(BatchPolicy policy) {
+    for (std::size_t game = 0; game < m_count; ++game) {
+      if (m_num_free[game] == 0) {
+        continue;
+      }
+      auto const row = statuses(game);
+      switch (policy) {
+      case BatchPolicy::LINEAR: {
+        std::size_t &cursor = m_linear[game];
+        while (row[cursor] != FREE) {
+          ++cursor;
+        }
+        m_moves[game] = cursor;
+        break;
+      }
+      case BatchPolicy::RANDOM: {
+        std::size_t &cursor = m_random[game];
+        while (row[random_node(game, cursor)] != FREE) {
+          ++cursor;
+        }
+        m_moves[game] = random_node(game, cursor);
+        break;
+      }
+      case BatchPolicy::HIGHEST: {
+        std::size_t &cursor = m_highest[game];
+        auto const *order = m_highest_order.data() + game * m_size;
+        while (row[order[cursor]] != FREE) {
+          ++cursor;
+        }
+        m_moves[game] = order[cursor];
+        break;
+      }
+      }
+    }
+  }
+
+  // occupies the chosen nodes and blocks their free neighbors
+  void apply_moves(status_t status) {
+    for (std::size_t game = 0; game < m_count; ++game) {
+      if (m_num_free[game] == 0) {
+        continue;
+      }
+      status_t *row = m_statuses.data() + game * m_size;
+      std::size_t const idx = m_moves[game];
+      std::size_t blocked{};
+      row[idx] = status;
+      if (m_size > 2) {
+        if (idx > 0 && row[idx - 1] == FREE) {
+          row[idx - 1] = BLOCKED;
+          ++blocked;
+        }
+        if (idx + 1 < m_size && row[idx + 1] == FREE) {
+          row[idx + 1] = BLOCKED;
+          ++blocked;
+        }
+      }
+      m_num_free[game] -= 1 + blocked;
+    }
+  }
+
+  // the scores of both players in one pass over each row; a group is a run
+  // of one player's nodes where BLOCKED nodes are skipped
+  void score() {
+    for (std::size_t game = 0; game < m_count; ++game) {
+      auto const row = statuses(game);
+      auto const values = nodes(game);
+      std::array<std::size_t, 4> scores{};
+      status_t current = FREE;
+      std::size_t sum{};
+      std::size_t size{};
+      auto close = [&]() {
+        scores[current] += size >= BONUS_MIN_GROUP_SIZE ? sum * BONUS_FACTOR
+                                                        : sum;
+        sum = 0;
+        size = 0;
+      };
+      for (std::size_t idx = 0; idx < m_size; ++idx) {
+        status_t const status = row[idx];
+        if (status == BLOCKED) {
+          continue;
+        }
+        if (status != current) {
+          close();
+          current = status;
+        }
+        sum += values[idx];
+        ++size;
+      }
+      close();
+      m_score_a[game] = scores[PLAYER_A];
+      m_score_b[game] = scores[PLAYER_B];
+    }
+  }
+
+public:
+  // a batch of count games on boards of this size
+  BatchSimulator(std::size_t size, std::size_t count)
+      : m_size(size),
+        m_count(count),
+        m_nodes(size * count),
+        m_statuses(size * count),
+        m_num_free(count),
+        m_moves(count),
+        m_linear(count),
+        m_random(count),
+        m_random_start(count),
+        m_random_forward(count),
+        m_highest(count),
+        m_highest_order(size * count),
+        m_score_a(count),
+        m_score_b(count) {
+    if (size == 0 || size > std::numeric_limits<std::uint32_t>::max()) {
+      throw FacilityGameException("Invalid board size for a batch");
+    }
+    // as FPlayerRandom::initialize
+    for (std::size_t value = 0; value <= MAX_VALUE; ++value) {
+      std::mt19937 gen(value);
+      m_random_starts[value] =
+          std::uniform_int_distribution<std::size_t>(0, m_size - 1)(gen);
+      m_random_forwards[value] =
+          std::uniform_int_distribution<int>(0, 1)(gen) == 0;
+    }
+  }
+
+  // sets up the boards of the seeds first_seed, first_seed + 1, ...; only
+  // the first num_games games of the batch are played
+  void reset(std::size_t first_seed, std::size_t num_games) {
+    std::ranges::fill(m_statuses, FREE);
+    std::ranges::fill(m_num_free, 0);
+    std::ranges::fill(m_linear, 0);
+    std::ranges::fill(m_random, 0);
+    std::ranges::fill(m_highest, 0);
+    for (std::size_t game = 0; game < std::min(num_games, m_count); ++game) {
+      std::span<node_t> const row(m_nodes.data() + game * m_size, m_size);
+      FacilityGame::fill_nodes(row, first_seed + game);
+      m_num_free[game] = m_size;
+
+      m_random_start[game] = m_random_starts[row[0]];
+      m_random_forward[game] = m_random_forwards[row[0]];
+
+      // counting sort by decreasing value, stable in the index
+      std::array<std::size_t, MAX_VALUE + 2> begin{};
+      for (node_t const value : row) {
+        ++begin[MAX_VALUE - value + 1];
+      }
+      for (std::size_t bucket = 1; bucket < begin.size(); ++bucket) {
+        begin[bucket] += begin[bucket - 1];
+      }
+      auto *order = m_highest_order.data() + game * m_size;
+      for (std::size_t idx = 0; idx < m_size; ++idx) {
+        order[begin[MAX_VALUE - row[idx]]++] = static_cast<std::uint32_t>(idx);
+      }
+    }
+  }
+
+  // plays all the games to the end, policy_a moving first
+  void run(BatchPolicy policy_a, BatchPolicy policy_b) {
+    while (std::ranges::any_of(m_num_free, [](std::size_t num_free) {
+      return num_free > 0;
+    })) {
+      choose_moves(policy_a);
+      apply_moves(PLAYER_A);
+      choose_moves(policy_b);
+      apply_moves(PLAYER_B);
+    }
+    score();
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_count;
+  }
+
+  [[nodiscard]] std::size_t get_score(std::size_t game, Player player) const {
+    return player == Player::PLAYER_A ? m_score_a[game] : m_score_b[game];
+  }
+};
+
+#endif // BATCH_SIMULATOR_H
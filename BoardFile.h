@@ -0,0 +1,214 @@
+#ifndef BOARD_FILE_H
+#define BOARD_FILE_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <string>
+
+#include "FacilityGame.h"
+#include "FacilityGameException.h"
+#include "MappedFile.h"
+
+// The binary board format, in the native byte order:
+//   BoardHeader
+//   the node values, size * node_bytes bytes, padded to 8 bytes
+//   the statuses, the two bit-planes of PackedStatuses, 64-bit words each
+//   the moves, num_moves 64-bit node indices
+// The rule constants are stored too, and a board is only opened with the
+// rules it was made for. The node values are used in place from the mapped
+// file, and the moves are replayed, which rebuilds the statuses; the stored
+// statuses are checked against them. Opening a board without moves reads the
+// node values once to check their range and allocates the statuses, 2 bits
+// per node; the other per-node structures of the game are only built by the
+// first move or the first query that needs them.
+struct BoardHeader {
+  static constexpr std::array<char, 8> MAGIC{
+      'F', 'A', 'C', 'B', 'O', 'A', 'R', 'D'};
+  static constexpr std::uint32_t VERSION = 1;
+  static constexpr std::uint32_t ORDER_MARK = 0x01020304;
+
+  std::array<char, 8> magic{MAGIC};
+  std::uint32_t version{VERSION};
+  std::uint32_t byte_order{ORDER_MARK};
+  std::uint64_t node_bytes{};
+  std::uint64_t size{};
+  std::uint64_t seed{};
+  std::uint64_t min_value{MIN_VALUE};
+  std::uint64_t max_value{MAX_VALUE};
+  std::uint64_t bonus_min_group_size{BONUS_MIN_GROUP_SIZE};
+  std::uint64_t bonus_factor{BONUS_FACTOR};
+  std::uint64_t num_moves{};
+};
+
+static_assert(sizeof(BoardHeader) == 80);
+
+// the offsets of the sections of a board file
+struct BoardLayout {
+  std::size_t nodes;
+  std::size_t statuses;
+  std::size_t num_words;
+  std::size_t moves;
+  std::size_t file_size;
+
+  explicit BoardLayout(BoardHeader const &header)
+      : nodes(sizeof(BoardHeader)),
+        statuses(
+            (nodes + header.size * header.node_bytes + sizeof(std::uint64_t)
+             - 1)
+            / sizeof(std::uint64_t) * sizeof(std::uint64_t)),
+        num_words(
+            (header.size + PackedStatuses::WORD_BITS - 1)
+            / PackedStatuses::WORD_BITS),
+        moves(statuses + 2 * num_words * sizeof(std::uint64_t)),
+        file_size(moves + header.num_moves * sizeof(std::uint64_t)) {}
+};
+
+// writes the board, the statuses and the moves of the game
+inline void save_board(FacilityGame const &game, std::string const &path) {
+  BoardHeader const header{
+      .node_bytes = sizeof(FacilityGame::node_t),
+      .size = game.get_num_nodes(),
+      .seed = game.get_seed(),
+      .num_moves = game.get_moves().size()};
+  BoardLayout const layout(header);
+
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  auto write = [&out](void const *data, std::size_t bytes) {
+    out.write(
+        static_cast<char const *>(data),
+        static_cast<std::streamsize>(bytes));
+  };
+  auto const nodes = game.get_nodes();
+  std::array<char, sizeof(std::uint64_t)> const padding{};
+  write(&header, sizeof(header));
+  write(nodes.data(), nodes.size_bytes());
+  write(padding.data(), layout.statuses - layout.nodes - nodes.size_bytes());
+  write(
+      game.get_statuses().high_words().data(),
+      game.get_statuses().high_words().size_bytes());
+  write(
+      game.get_statuses().low_words().data(),
+      game.get_statuses().low_words().size_bytes());
+  for (std::size_t move : game.get_moves()) {
+    std::uint64_t const value = move;
+    write(&value, sizeof(value));
+  }
+  if (!out.flush()) {
+    throw FacilityGameException(("Cannot write board: " + path).c_str());
+  }
+}
+
+// a board file mapped read-only into memory
+class MappedBoard {
+private:
+  MappedFile m_file;
+  BoardHeader m_header{};
+
+  [[noreturn]] static void fail(std::string const &path, char const *reason) {
+    MappedFile::fail("board " + path, reason);
+  }
+
+  template <typename T>
+  [[nodiscard]] std::span<T const> section(
+      std::size_t offset,
+      std::size_t count) const {
+    return {
+        reinterpret_cast<T const *>(m_file.bytes().data() + offset),
+        count};
+  }
+
+  void validate(std::string const &path) const {
+    if (m_header.magic != BoardHeader::MAGIC) {
+      fail(path, "not a board file");
+    }
+    if (m_header.version != BoardHeader::VERSION) {
+      fail(path, "unsupported version");
+    }
+    if (m_header.byte_order != BoardHeader::ORDER_MARK) {
+      fail(path, "wrong byte order");
+    }
+    if (m_header.node_bytes != sizeof(FacilityGame::node_t)) {
+      fail(path, "wrong node value size");
+    }
+    if (m_header.min_value != MIN_VALUE || m_header.max_value != MAX_VALUE
+        || m_header.bonus_min_group_size != BONUS_MIN_GROUP_SIZE
+        || m_header.bonus_factor != BONUS_FACTOR) {
+      fail(path, "made for other rules");
+    }
+    if (m_header.size > m_file.size() || m_header.num_moves > m_file.size()
+        || m_file.size() != BoardLayout(m_header).file_size) {
+      fail(path, "wrong file size");
+    }
+    // a single pass over the mapped values, without any allocation
+    if (!nodes().empty()) {
+      auto const [min, max] = std::ranges::minmax(nodes());
+      if (min < 1 || max > MAX_VALUE) {
+        fail(path, "node value out of range");
+      }
+    }
+  }
+
+public:
+  explicit MappedBoard(std::string const &path) : m_file(path) {
+    if (m_file.size() < sizeof(BoardHeader)) {
+      fail(path, "too short");
+    }
+    std::memcpy(&m_header, m_file.bytes().data(), sizeof(BoardHeader));
+    validate(path);
+  }
+
+  [[nodiscard]] BoardHeader const &get_header() const {
+    return m_header;
+  }
+
+  [[nodiscard]] std::span<FacilityGame::node_t const> nodes() const {
+    return section<FacilityGame::node_t>(
+        BoardLayout(m_header).nodes,
+        m_header.size);
+  }
+
+  [[nodiscard]] std::span<std::uint64_t const> high_words() const {
+    BoardLayout const layout(m_header);
+    return section<std::uint64_t>(layout.statuses, layout.num_words);
+  }
+
+  [[nodiscard]] std::span<std::uint64_t const> low_words() const {
+    BoardLayout const layout(m_header);
+    return section<std::uint64_t>(
+        layout.statuses + layout.num_words * sizeof(std::uint64_t),
+        layout.num_words);
+  }
+
+  [[nodiscard]] std::span<std::uint64_t const> moves() const {
+    return section<std::uint64_t>(
+        BoardLayout(m_header).moves,
+        m_header.num_moves);
+  }
+};
+
+// maps the board file and replays its moves; the game keeps the mapping
+// alive, and so do its copies
+inline FacilityGame load_board(std::string const &path) {
+  auto board = std::make_shared<MappedBoard const>(path);
+  FacilityGame game(board, board->nodes(), board->get_header().seed);
+  for (std::uint64_t move : board->moves()) {
+    if (!game.append_move(game.get_player_to_move(), move)) {
+      throw FacilityGameException(
+          ("Invalid move in board " + path).c_str());
+    }
+  }
+  auto const &statuses = game.get_statuses();
+  if (!std::ranges::equal(statuses.high_words(), board->high_words())
+      || !std::ranges::equal(statuses.low_words(), board->low_words())) {
+    throw FacilityGameException(
+        ("The statuses do not match the moves in board " + path).c_str());
+  }
+  return game;
+}
+
+#endif // BOARD_FILE_H
@@ -0,0 +1,80 @@
+#ifndef BOOK_PLAYER_H
+#define BOOK_PLAYER_H
+
+#include <algorithm>
+#include <memory>
+#include <span>
+
+#include "FPlayer.h"
+#include "FacilityGame.h"
+#include "OpeningBook.h"
+
+// Plays the moves of the line of the board from an opening book while the
+// game follows it, and the moves of the player after that. The line is found
+// once, in initialize, and every move from it is then answered in O(1). The
+// player only sees the game once it leaves the book, so it is initialized
+// then, on the position reached, or in initialize if the book has no line
+// for the board.
+class BookPlayer final : public FPlayer {
+private:
+  static constexpr char const *PLAYER_NAME = "Book";
+  static constexpr char const *VERSION = "1.0";
+  static constexpr char const *FIRSTNAME = "";
+  static constexpr char const *LASTNAME = "";
+
+  std::unique_ptr<FPlayer> m_player;
+  std::shared_ptr<OpeningBook const> m_book;
+  std::span<std::size_t const> m_line;
+  // the moves of the game already checked against the line
+  std::size_t m_num_checked{};
+  bool m_in_book{};
+  std::size_t m_book_moves{};
+
+public:
+  BookPlayer(
+      std::unique_ptr<FPlayer> player,
+      Player seat,
+      std::shared_ptr<OpeningBook const> book)
+      : FPlayer(seat, PLAYER_NAME, VERSION, FIRSTNAME, LASTNAME),
+        m_player(std::move(player)),
+        m_book(std::move(book)) {}
+
+  void initialize(FacilityGame const &game) override {
+    m_line = m_book->find(game);
+    m_num_checked = 0;
+    m_in_book = !m_line.empty();
+    m_book_moves = 0;
+    if (!m_in_book) {
+      m_player->initialize(game);
+    }
+  }
+
+  std::size_t next_move(FacilityGame const &game) override {
+    if (m_in_book) {
+      auto const &moves = game.get_moves();
+      if (moves.size() < m_line.size()
+          && std::equal(
+              moves.begin() + static_cast<std::ptrdiff_t>(m_num_checked),
+              moves.end(),
+              m_line.begin() + static_cast<std::ptrdiff_t>(m_num_checked))) {
+        m_num_checked = moves.size() + 1;
+        ++m_book_moves;
+        return m_line[moves.size()];
+      }
+      m_in_book = false;
+      m_player->initialize(game);
+    }
+    return m_player->next_move(game);
+  }
+
+  void request_stop() override {
+    m_player->request_stop();
+  }
+
+  // the moves played from the book since initialize
+  [[nodiscard]] std::size_t get_book_moves() const {
+    return m_book_moves;
+  }
+};
+
+#endif // BOOK_PLAYER_H
@@ -0,0 +1,60 @@
+#ifndef COMMAND_LINE_H
+#define COMMAND_LINE_H
+
+#include <charconv>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <string_view>
+
+#include "FacilityGameException.h"
+
+// The option parsing shared by facility_game and facility_bench. Options are
+// walked with an index into the arguments, and every error throws a
+// FacilityGameException, which main prints with the usage.
+
+inline std::size_t parse_number(std::string_view text) {
+  std::size_t value{};
+  auto [ptr, ec] = std::from_chars(text.begin(), text.end(), value);
+  if (ec != std::errc{} || ptr != text.end()) {
+    throw FacilityGameException(
+        ("Invalid number: " + std::string(text)).c_str());
+  }
+  return value;
+}
+
+inline double parse_real(std::string_view text) {
+  double value{};
+  auto [ptr, ec] = std::from_chars(text.begin(), text.end(), value);
+  if (ec != std::errc{} || ptr != text.end()) {
+    throw FacilityGameException(
+        ("Invalid number: " + std::string(text)).c_str());
+  }
+  return value;
+}
+
+// the value of --threads, which has to leave at least one worker
+inline std::size_t parse_threads(std::string_view text) {
+  std::size_t const value = parse_number(text);
+  if (value == 0) {
+    throw FacilityGameException("The number of threads must be at least 1");
+  }
+  return value;
+}
+
+// the value of the option at idx, which moves idx past it
+inline std::string_view option_value(
+    std::span<char const *const> args,
+    std::size_t &idx) {
+  if (idx + 1 >= args.size()) {
+    throw FacilityGameException(
+        ("Missing value for " + std::string(args[idx])).c_str());
+  }
+  return args[++idx];
+}
+
+[[noreturn]] inline void unknown_option(std::string_view arg) {
+  throw FacilityGameException(("Unknown option: " + std::string(arg)).c_str());
+}
+
+#endif // COMMAND_LINE_H
@@ -0,0 +1,633 @@
+#ifndef ENDGAME_SOLVER_H
+#define ENDGAME_SOLVER_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "FacilityGame.h"
+
+// Exact solver for the end of a game. Occupying a node only blocks its
+// immediate neighbors, so the FREE nodes split into segments, and a move in a
+// segment only changes the scoring groups right before and after it. The
+// segments which share such a group form a component, and the components add
+// up: the score of every group is counted in exactly one component, or in
+// none if it touches no segment.
+//
+// The position is split into components once, at the root. A component is
+// keyed by its contents: the node values of its segments and the groups next
+// to them (the owner, the size up to the bonus size, and the sum while the
+// bonus has not been reached). Its states, their moves for both players and
+// the score difference every move gains are cached under that key, across
+// solves and boards. The search then runs over the sum of the components:
+// a position is the state of every component and the player to move, keyed
+// by an order-independent hash of the component states, so positions which
+// only differ in the order of their moves or in where equal components lie
+// are searched once. The players alternate over all the components, so the
+// tempo of every component matters and the values of the components cannot
+// simply be added; once a single component is left though, its value only
+// depends on its state and the player to move, and it is solved once and
+// cached with the component.
+class EndgameSolver {
+public:
+  using value_t = std::int64_t;
+
+  struct Result {
+    std::size_t move;
+    // the final score difference, for the player to move
+    value_t value;
+  };
+
+  struct Stats {
+    std::size_t nodes{};
+    // the positions with a single component left whose value was cached
+    std::size_t component_hits{};
+  };
+
+private:
+  static constexpr value_t INF = std::numeric_limits<value_t>::max() / 2;
+  // a component state keeps 2 status bits per node in a 64-bit word
+  static constexpr std::size_t MAX_COMPONENT_NODES = 32;
+  // the cached states of all the components, before the cache is dropped
+  static constexpr std::size_t MAX_STATES = 1 << 22;
+  static constexpr std::uint64_t NO_MOVE =
+      std::numeric_limits<std::uint64_t>::max();
+  static constexpr std::uint64_t SIDE_KEY = 0x9e3779b97f4a7c15ULL;
+
+  enum class Bound : std::uint8_t { EXACT, LOWER, UPPER };
+
+  struct TTEntry {
+    std::uint64_t key{};
+    value_t value{};
+    std::uint64_t move{NO_MOVE};
+    Bound bound{};
+  };
+
+  // a scoring group next to a segment; owner is the FacilityStatus of its
+  // nodes, or 0 at the end of the board
+  struct Context {
+    std::size_t owner{};
+    std::size_t size{};
+    std::size_t sum{};
+  };
+
+  struct Move {
+    std::uint32_t child;
+    std::uint32_t node;
+    // the score difference the move adds for the player making it
+    value_t gain;
+  };
+
+  struct State {
+    // the FacilityStatus of every node, 2 bits each
+    std::uint64_t statuses{};
+    std::size_t num_free{};
+    // the scores of PLAYER_A and PLAYER_B over the groups of the component
+    std::array<value_t, 2> score{};
+    std::array<std::vector<Move>, 2> moves;
+    std::array<bool, 2> expanded{};
+    // the value of the state when no other component is left, for the
+    // player to move
+    std::array<value_t, 2> alone{};
+    std::array<bool, 2> solved{};
+  };
+
+  // segments[k] starts at the node segment_first[k], and contexts[k] is the
+  // group before it; the last context is the group after the last segment
+  struct Component {
+    std::vector<std::size_t> values;
+    std::vector<std::size_t> segment_first;
+    std::vector<Context> contexts;
+    // no move blocks its neighbors on boards of 2 nodes or less
+    bool blocks{};
+    std::unordered_map<std::uint64_t, std::uint32_t> state_ids;
+    std::vector<State> states;
+  };
+
+  struct ComponentKeyHash {
+    std::size_t operator()(std::vector<std::size_t> const &key) const {
+      std::size_t hash = key.size();
+      for (std::size_t item : key) {
+        hash ^= item + 0x9e3779b97f4a7c15ULL + (hash << 6U) + (hash >> 2U);
+      }
+      return hash;
+    }
+  };
+
+  // a component of the position being solved, and the board nodes of its
+  // local nodes
+  struct Live {
+    std::uint32_t type;
+    std::uint32_t state;
+    std::vector<std::size_t> nodes;
+  };
+
+  struct Candidate {
+    std::size_t live;
+    std::size_t move;
+    value_t gain;
+    bool tt_move;
+  };
+
+  std::vector<TTEntry> m_table;
+  std::vector<Component> m_types;
+  std::unordered_map<std::vector<std::size_t>, std::uint32_t, ComponentKeyHash>
+      m_type_ids;
+  std::size_t m_num_states{};
+  std::vector<Live> m_live;
+  std::vector<std::vector<Candidate>> m_candidates;
+  std::size_t m_max_nodes{};
+  bool m_aborted{};
+  Stats m_stats;
+
+  [[nodiscard]] static std::size_t player_index(Player player) {
+    return player == Player::PLAYER_A ? 0 : 1;
+  }
+
+  [[nodiscard]] static Player opponent(Player player) {
+    return player == Player::PLAYER_A ? Player::PLAYER_B : Player::PLAYER_A;
+  }
+
+  [[nodiscard]] static std::uint64_t status_at(
+      std::uint64_t statuses,
+      std::size_t node) {
+    return (statuses >> (2 * node)) & 0b11U;
+  }
+
+  [[nodiscard]] static std::uint64_t with_status(
+      std::uint64_t statuses,
+      std::size_t node,
+      FacilityStatus status) {
+    return (statuses & ~(std::uint64_t{0b11} << (2 * node)))
+           | (std::uint64_t{static_cast<unsigned>(status)} << (2 * node));
+  }
+
+  [[nodiscard]] static value_t group_score(std::size_t size, std::size_t sum) {
+    return static_cast<value_t>(
+        size >= BONUS_MIN_GROUP_SIZE ? sum * BONUS_FACTOR : sum);
+  }
+
+  // the scores of both players over the groups of the component, by the same
+  // rules as FacilityGame::compute_score
+  [[nodiscard]] static std::array<value_t, 2> score(
+      Component const &component,
+      std::uint64_t statuses) {
+    std::array<value_t, 2> scores{};
+    std::size_t owner{};
+    std::size_t size{};
+    std::size_t sum{};
+    auto close = [&]() {
+      if (owner != 0) {
+        scores[owner - static_cast<unsigned>(FacilityStatus::PLAYER_A)] +=
+            group_score(size, sum);
+      }
+      owner = 0;
+      size = 0;
+      sum = 0;
+    };
+    auto add = [&](std::size_t node_owner, std::size_t num, std::size_t value) {
+      if (node_owner != owner) {
+        close();
+        owner = node_owner;
+      }
+      size += num;
+      sum += value;
+    };
+    std::size_t const num_segments = component.segment_first.size();
+    for (std::size_t segment = 0; segment <= num_segments; ++segment) {
+      Context const &context = component.contexts[segment];
+      if (context.owner != 0) {
+        add(context.owner, context.size, context.sum);
+      } else {
+        close();
+      }
+      if (segment == num_segments) {
+        break;
+      }
+      std::size_t const end = segment + 1 < num_segments
+                                  ? component.segment_first[segment + 1]
+                                  : component.values.size();
+      for (std::size_t node = component.segment_first[segment]; node < end;
+           ++node) {
+        auto const status = status_at(statuses, node);
+        if (status == static_cast<unsigned>(FacilityStatus::FREE)) {
+          close();
+        } else if (status != static_cast<unsigned>(FacilityStatus::BLOCKED)) {
+          add(status, 1, component.values[node]);
+        }
+      }
+    }
+    close();
+    return scores;
+  }
+
+  [[nodiscard]] std::uint32_t state_id(
+      Component &component,
+      std::uint64_t statuses) {
+    auto const [it, added] = component.state_ids.try_emplace(
+        statuses,
+        static_cast<std::uint32_t>(component.states.size()));
+    if (added) {
+      State &state = component.states.emplace_back();
+      state.statuses = statuses;
+      for (std::size_t node = 0; node < component.values.size(); ++node) {
+        if (status_at(statuses, node)
+            == static_cast<unsigned>(FacilityStatus::FREE)) {
+          ++state.num_free;
+        }
+      }
+      state.score = score(component, statuses);
+      ++m_num_states;
+    }
+    return it->second;
+  }
+
+  // whether the local nodes node - 1 and node are in the same segment
+  [[nodiscard]] static bool same_segment(
+      Component const &component,
+      std::size_t node) {
+    return node > 0
+           && !std::ranges::binary_search(component.segment_first, node);
+  }
+
+  // the moves of a player from a state, by decreasing gain
+  std::vector<Move> const &moves(
+      std::uint32_t type,
+      std::uint32_t id,
+      Player player) {
+    Component &component = m_types[type];
+    std::size_t const me = player_index(player);
+    if (component.states[id].expanded[me]) {
+      return component.states[id].moves[me];
+    }
+    auto const status = player == Player::PLAYER_A ? FacilityStatus::PLAYER_A
+                                                   : FacilityStatus::PLAYER_B;
+    std::uint64_t const statuses = component.states[id].statuses;
+    std::vector<Move> result;
+    for (std::size_t node = 0; node < component.values.size(); ++node) {
+      if (status_at(statuses, node)
+          != static_cast<unsigned>(FacilityStatus::FREE)) {
+        continue;
+      }
+      std::uint64_t child = with_status(statuses, node, status);
+      if (component.blocks) {
+        if (same_segment(component, node)
+            && status_at(child, node - 1)
+                   == static_cast<unsigned>(FacilityStatus::FREE)) {
+          child = with_status(child, node - 1, FacilityStatus::BLOCKED);
+        }
+        if (node + 1 < component.values.size()
+            && same_segment(component, node + 1)
+            && status_at(child, node + 1)
+                   == static_cast<unsigned>(FacilityStatus::FREE)) {
+          child = with_status(child, node + 1, FacilityStatus::BLOCKED);
+        }
+      }
+      std::uint32_t const child_id = state_id(component, child);
+      auto const &before = component.states[id].score;
+      auto const &after = component.states[child_id].score;
+      result.push_back(
+          {child_id,
+           static_cast<std::uint32_t>(node),
+           (after[me] - before[me]) - (after[1 - me] - before[1 - me])});
+    }
+    std::ranges::sort(result, [](Move const &lhs, Move const &rhs) {
+      return lhs.gain > rhs.gain
+             || (lhs.gain == rhs.gain && lhs.node < rhs.node);
+    });
+    State &state = component.states[id];
+    state.moves[me] = std::move(result);
+    state.expanded[me] = true;
+    return state.moves[me];
+  }
+
+  // the value of a state of a component when it is the only one left, by a
+  // full search of its states, each of which is solved once
+  value_t alone(std::uint32_t type, std::uint32_t id, Player player) {
+    std::size_t const me = player_index(player);
+    if (m_types[type].states[id].solved[me]) {
+      return m_types[type].states[id].alone[me];
+    }
+    if (++m_stats.nodes > m_max_nodes) {
+      m_aborted = true;
+      return 0;
+    }
+    value_t best = m_types[type].states[id].num_free == 0 ? 0 : -INF;
+    // the moves are copied, since solving the children adds states
+    auto const candidates = moves(type, id, player);
+    for (auto const &move : candidates) {
+      value_t const value =
+          move.gain - alone(type, move.child, opponent(player));
+      if (m_aborted) {
+        return 0;
+      }
+      best = std::max(best, value);
+    }
+    State &state = m_types[type].states[id];
+    state.alone[me] = best;
+    state.solved[me] = true;
+    return best;
+  }
+
+  [[nodiscard]] static std::uint64_t mix(std::uint64_t z) {
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31U);
+  }
+
+  // a move as the component state it is made from and its node, the same
+  // for equal components wherever they are
+  [[nodiscard]] static std::uint64_t move_key(
+      Live const &live,
+      Move const &move) {
+    return mix((std::uint64_t{live.type} << 32U | live.state) ^ move.node);
+  }
+
+  // the moves of all the components, the tt move first, then by gain
+  std::vector<Candidate> &ordered_moves(
+      Player player,
+      std::size_t ply,
+      std::uint64_t tt_move) {
+    if (m_candidates.size() <= ply) {
+      m_candidates.resize(ply + 1);
+    }
+    auto &candidates = m_candidates[ply];
+    candidates.clear();
+    for (std::size_t idx = 0; idx < m_live.size(); ++idx) {
+      Live const &live = m_live[idx];
+      auto const &list = moves(live.type, live.state, player);
+      for (std::size_t move = 0; move < list.size(); ++move) {
+        candidates.push_back(
+            {idx,
+             move,
+             list[move].gain,
+             move_key(live, list[move]) == tt_move});
+      }
+    }
+    std::ranges::stable_sort(
+        candidates,
+        [](Candidate const &lhs, Candidate const &rhs) {
+          return lhs.tt_move > rhs.tt_move
+                 || (lhs.tt_move == rhs.tt_move && lhs.gain > rhs.gain);
+        });
+    return candidates;
+  }
+
+  // the score difference the rest of the game adds for the player to move
+  value_t negamax(Player player, value_t alpha, value_t beta, std::size_t ply) {
+    if (++m_stats.nodes > m_max_nodes) {
+      m_aborted = true;
+      return 0;
+    }
+    std::uint64_t key = player == Player::PLAYER_B ? SIDE_KEY : 0;
+    std::size_t num_open{};
+    Live const *last_open{};
+    for (auto const &live : m_live) {
+      if (m_types[live.type].states[live.state].num_free > 0) {
+        ++num_open;
+        last_open = &live;
+        key += mix(std::uint64_t{live.type} << 32U | live.state);
+      }
+    }
+    if (num_open == 0) {
+      return 0;
+    }
+    if (num_open == 1) {
+      if (m_types[last_open->type].states[last_open->state]
+              .solved[player_index(player)]) {
+        ++m_stats.component_hits;
+      }
+      return alone(last_open->type, last_open->state, player);
+    }
+
+    value_t const alpha_orig = alpha;
+    TTEntry &entry = m_table[key & (m_table.size() - 1)];
+    std::uint64_t tt_move = NO_MOVE;
+    // the bounds only cut, they do not narrow the window, so that a full
+    // window search always returns the exact value
+    if (entry.key == key) {
+      tt_move = entry.move;
+      if (entry.bound == Bound::EXACT
+          || (entry.bound == Bound::LOWER && entry.value >= beta)
+          || (entry.bound == Bound::UPPER && entry.value <= alpha)) {
+        return entry.value;
+      }
+    }
+
+    value_t best = -INF;
+    std::uint64_t best_move = NO_MOVE;
+    for (auto const &candidate : ordered_moves(player, ply, tt_move)) {
+      Live &live = m_live[candidate.live];
+      std::uint32_t const parent = live.state;
+      Move const move =
+          m_types[live.type].states[parent].moves[player_index(player)]
+                                                 [candidate.move];
+      live.state = move.child;
+      value_t const value =
+          move.gain
+          - negamax(
+              opponent(player),
+              move.gain - beta,
+              move.gain - alpha,
+              ply + 1);
+      live.state = parent;
+      if (m_aborted) {
+        return 0;
+      }
+      if (value > best) {
+        best = value;
+        best_move = move_key(live, move);
+      }
+      alpha = std::max(alpha, value);
+      if (alpha >= beta) {
+        break;
+      }
+    }
+
+    Bound bound = Bound::EXACT;
+    if (best <= alpha_orig) {
+      bound = Bound::UPPER;
+    } else if (best >= beta) {
+      bound = Bound::LOWER;
+    }
+    m_table[key & (m_table.size() - 1)] = {key, best, best_move, bound};
+    return best;
+  }
+
+  [[nodiscard]] static Context context(
+      FacilityGame const &game,
+      std::optional<std::size_t> idx) {
+    if (!idx) {
+      return {};
+    }
+    auto const [sum, size] = game.get_group(*idx);
+    return {
+        static_cast<std::size_t>(game.get_status(*idx)),
+        std::min(size, BONUS_MIN_GROUP_SIZE),
+        size >= BONUS_MIN_GROUP_SIZE ? 0 : sum};
+  }
+
+  // a component of the position, while it is being built
+  struct Builder {
+    std::vector<std::size_t> key;
+    Component component;
+    std::vector<std::size_t> nodes;
+  };
+
+  void push_context(Builder &builder, Context const &context) const {
+    builder.component.contexts.push_back(context);
+    builder.key.insert(
+        builder.key.end(),
+        {context.owner, context.size, context.sum});
+  }
+
+  void add_component(Builder &builder) {
+    auto const [it, added] = m_type_ids.try_emplace(
+        std::move(builder.key),
+        static_cast<std::uint32_t>(m_types.size()));
+    if (added) {
+      m_types.push_back(std::move(builder.component));
+    }
+    m_live.push_back(
+        {it->second,
+         state_id(m_types[it->second], 0),
+         std::move(builder.nodes)});
+    builder = {};
+  }
+
+  // splits the FREE nodes of the game into components; false if one of them
+  // has too many nodes
+  [[nodiscard]] bool split(FacilityGame const &game) {
+    m_live.clear();
+    auto const &statuses = game.get_statuses();
+    std::size_t const n = statuses.size();
+    bool const blocks = n > 2;
+
+    Builder builder;
+    std::optional<std::size_t> prev_right;
+    for (std::size_t first = statuses.find_first_free(); first < n;
+         first = statuses.find_first_free(first + 1)) {
+      std::size_t last = first;
+      while (last + 1 < n && statuses[last + 1] == FacilityStatus::FREE) {
+        ++last;
+      }
+
+      // the closest occupied nodes before and after the segment; a BLOCKED
+      // node next to it always has an occupied node on its other side
+      std::optional<std::size_t> left;
+      if (first >= 1 && statuses[first - 1] != FacilityStatus::BLOCKED) {
+        left = first - 1;
+      } else if (first >= 2) {
+        left = first - 2;
+      }
+      std::optional<std::size_t> right;
+      if (last + 1 < n && statuses[last + 1] != FacilityStatus::BLOCKED) {
+        right = last + 1;
+      } else if (last + 2 < n) {
+        right = last + 2;
+      }
+
+      bool const shared = prev_right && left
+                          && game.get_group_other_end(*prev_right) == *left;
+      if (!builder.nodes.empty() && !shared) {
+        push_context(builder, context(game, prev_right));
+        add_component(builder);
+      }
+      if (builder.nodes.empty()) {
+        builder.component.blocks = blocks;
+        builder.key.push_back(blocks ? 1 : 0);
+        push_context(builder, context(game, left));
+      } else {
+        push_context(builder, context(game, prev_right));
+      }
+      builder.component.segment_first.push_back(builder.nodes.size());
+      builder.key.push_back(last - first + 1);
+      for (std::size_t idx = first; idx <= last; ++idx) {
+        builder.component.values.push_back(game.get_node(idx));
+        builder.key.push_back(game.get_node(idx));
+        builder.nodes.push_back(idx);
+      }
+      if (builder.nodes.size() > MAX_COMPONENT_NODES) {
+        return false;
+      }
+      prev_right = right;
+      first = last;
+    }
+    if (!builder.nodes.empty()) {
+      push_context(builder, context(game, prev_right));
+      add_component(builder);
+    }
+    return true;
+  }
+
+public:
+  explicit EndgameSolver(std::size_t tt_size_log2 = 16)
+      : m_table(std::size_t{1} << tt_size_log2) {}
+
+  // the best move and the final score difference with perfect play from both
+  // sides, or nothing if the game is finished, a component has more than
+  // MAX_COMPONENT_NODES nodes, or more than max_nodes nodes were needed
+  std::optional<Result> solve(FacilityGame const &game, std::size_t max_nodes) {
+    if (game.is_finished()) {
+      return std::nullopt;
+    }
+    if (m_num_states >= MAX_STATES) {
+      m_types.clear();
+      m_type_ids.clear();
+      m_num_states = 0;
+      clear();
+    }
+    m_max_nodes = max_nodes;
+    m_aborted = false;
+    m_stats = {};
+    if (!split(game)) {
+      return std::nullopt;
+    }
+
+    Player const player = game.get_player_to_move();
+    value_t best = -INF;
+    std::size_t best_node = 0;
+    for (auto const &candidate : ordered_moves(player, 0, NO_MOVE)) {
+      Live &live = m_live[candidate.live];
+      std::uint32_t const parent = live.state;
+      Move const move =
+          m_types[live.type].states[parent].moves[player_index(player)]
+                                                 [candidate.move];
+      live.state = move.child;
+      value_t const value =
+          move.gain
+          - negamax(opponent(player), move.gain - INF, move.gain - best, 1);
+      live.state = parent;
+      if (m_aborted) {
+        return std::nullopt;
+      }
+      if (value > best) {
+        best = value;
+        best_node = live.nodes[move.node];
+      }
+    }
+    value_t const current =
+        static_cast<value_t>(game.get_score(player))
+        - static_cast<value_t>(game.get_score(opponent(player)));
+    return Result{best_node, current + best};
+  }
+
+  // the statistics of the last solve
+  [[nodiscard]] Stats const &get_stats() const {
+    return m_stats;
+  }
+
+  // the hash of a position does not depend on the board, but the components
+  // are only equal if their node values are, so the transposition table is
+  // dropped for a new board and the cached components stay valid
+  void clear() {
+    std::ranges::fill(m_table, TTEntry{});
+  }
+};
+
+#endif // ENDGAME_SOLVER_H
@@ -35,6 +35,12 @@ public:
 
   virtual void initialize([[maybe_unused]] FacilityGame const &game) = 0;
   virtual std::size_t next_move(FacilityGame const &game) = 0;
+
+  // called from another thread while initialize or next_move runs, e.g. by
+  // a time control which gave up on the player: the call should return as
+  // soon as it can, and so should every later one; the players which never
+  // take long ignore it
+  virtual void request_stop() {}
 };
 
 #endif // FPLAYER_H
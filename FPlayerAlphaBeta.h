@@ -0,0 +1,341 @@
+#ifndef FPLAYER_ALPHA_BETA_H
+#define FPLAYER_ALPHA_BETA_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "EndgameSolver.h"
+#include "FPlayer.h"
+#include "FacilityGameException.h"
+
+struct SearchLimits {
+  std::size_t max_depth{64};
+  // a node budget makes the search deterministic, unlike the time budget
+  std::size_t max_nodes{std::numeric_limits<std::size_t>::max()};
+  std::chrono::milliseconds max_time{100};
+  // the number of moves searched at every node, ordered by their gain
+  std::size_t max_width{16};
+  // the transposition table has 2^tt_size_log2 entries
+  std::size_t tt_size_log2{16};
+  // with this many FREE nodes or less the EndgameSolver takes over, unless
+  // it needs more than endgame_max_nodes nodes
+  std::size_t endgame_free{20};
+  std::size_t endgame_max_nodes{1000000};
+};
+
+struct SearchStats {
+  std::size_t nodes{};
+  std::size_t depth{};
+  std::chrono::nanoseconds time{};
+
+  [[nodiscard]] double nodes_per_sec() const {
+    return static_cast<double>(nodes)
+           / std::chrono::duration<double>(time).count();
+  }
+};
+
+// Negamax alpha-beta search with iterative deepening, evaluating positions by
+// the score difference. Moves are ordered by the best move of the previous
+// iteration (from the transposition table), then the killer moves of the ply,
+// then by how much they increase the score of the player making them. The
+// transposition table is keyed by the Zobrist hash of the board.
+class FPlayerAlphaBeta final : public FPlayer {
+private:
+  static constexpr char const *PLAYER_NAME = "AlphaBeta";
+  static constexpr char const *VERSION = "1.0";
+  static constexpr char const *FIRSTNAME = "";
+  static constexpr char const *LASTNAME = "";
+
+  using value_t = std::int64_t;
+  using clock_t = std::chrono::steady_clock;
+
+  static constexpr value_t INF = std::numeric_limits<value_t>::max() / 2;
+  static constexpr std::size_t NO_MOVE =
+      std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t TIME_CHECK_INTERVAL = 256;
+
+  enum class Bound : std::uint8_t { EXACT, LOWER, UPPER };
+
+  struct TTEntry {
+    std::uint64_t key{};
+    value_t value{};
+    std::size_t move{NO_MOVE};
+    std::size_t depth{};
+    Bound bound{};
+  };
+
+  struct Candidate {
+    std::size_t idx;
+    value_t gain;
+  };
+
+  SearchLimits m_limits;
+  std::optional<FacilityGame> m_board;
+  EndgameSolver m_endgame;
+  std::vector<TTEntry> m_table;
+  std::vector<std::array<std::size_t, 2>> m_killers;
+  std::vector<std::vector<Candidate>> m_candidates;
+  std::vector<std::size_t> m_root_moves;
+  clock_t::time_point m_deadline;
+  bool m_aborted{};
+  std::atomic<bool> m_stop_requested{};
+  SearchStats m_stats;
+  SearchStats m_total_stats;
+
+  void make(std::size_t idx) {
+    m_board->append_move(m_board->get_player_to_move(), idx);
+  }
+
+  void unmake() {
+    m_board->undo_move();
+  }
+
+  // replays the moves of the game which are not on the private board yet
+  void sync(FacilityGame const &game) {
+    auto const &moves = game.get_moves();
+    if (!m_board || m_board->get_moves().size() > moves.size()) {
+      m_board = game;
+      m_board->clear();
+    }
+    for (std::size_t idx = m_board->get_moves().size(); idx < moves.size();
+         ++idx) {
+      make(moves[idx]);
+    }
+  }
+
+  [[nodiscard]] value_t evaluate() const {
+    Player const me = m_board->get_player_to_move();
+    Player const opponent =
+        me == Player::PLAYER_A ? Player::PLAYER_B : Player::PLAYER_A;
+    return static_cast<value_t>(m_board->get_score(me))
+           - static_cast<value_t>(m_board->get_score(opponent));
+  }
+
+  [[nodiscard]] bool out_of_budget() const {
+    if (m_stats.nodes >= m_limits.max_nodes) {
+      return true;
+    }
+    return m_stats.nodes % TIME_CHECK_INTERVAL == 0
+           && (clock_t::now() >= m_deadline
+               || m_stop_requested.load(std::memory_order_relaxed));
+  }
+
+  // all the free nodes, ordered by the tt move, the killers and their gain,
+  // and cut down to max_width moves
+  std::vector<Candidate> &ordered_moves(
+      std::size_t ply,
+      std::size_t tt_move) {
+    if (m_candidates.size() <= ply) {
+      m_candidates.resize(ply + 1);
+      m_killers.resize(ply + 1, {NO_MOVE, NO_MOVE});
+    }
+    auto &candidates = m_candidates[ply];
+    candidates.clear();
+
+    FacilityGame &board = *m_board;
+    Player const me = board.get_player_to_move();
+    value_t const score = static_cast<value_t>(board.get_score(me));
+    auto const &statuses = board.get_statuses();
+    for (std::size_t idx = statuses.find_first_free(); idx < statuses.size();
+         idx = statuses.find_first_free(idx + 1)) {
+      board.append_move(me, idx);
+      value_t gain = static_cast<value_t>(board.get_score(me)) - score;
+      board.undo_move();
+
+      if (idx == tt_move) {
+        gain = INF;
+      } else if (idx == m_killers[ply][0] || idx == m_killers[ply][1]) {
+        gain += INF / 2;
+      }
+      candidates.push_back({idx, gain});
+    }
+
+    auto const width = std::min(candidates.size(), m_limits.max_width);
+    std::partial_sort(
+        candidates.begin(),
+        candidates.begin() + static_cast<std::ptrdiff_t>(width),
+        candidates.end(),
+        [](Candidate const &lhs, Candidate const &rhs) {
+          return lhs.gain > rhs.gain
+                 || (lhs.gain == rhs.gain && lhs.idx < rhs.idx);
+        });
+    candidates.resize(width);
+    return candidates;
+  }
+
+  value_t negamax(
+      std::size_t depth,
+      value_t alpha,
+      value_t beta,
+      std::size_t ply) {
+    ++m_stats.nodes;
+    if (out_of_budget()) {
+      m_aborted = true;
+      return 0;
+    }
+    if (depth == 0 || m_board->is_finished()) {
+      return evaluate();
+    }
+
+    value_t const alpha_orig = alpha;
+    std::uint64_t const key = m_board->get_hash();
+    TTEntry &entry = m_table[key & (m_table.size() - 1)];
+    std::size_t tt_move = NO_MOVE;
+    if (entry.key == key) {
+      tt_move = entry.move;
+      if (entry.depth >= depth) {
+        if (entry.bound == Bound::EXACT) {
+          return entry.value;
+        }
+        if (entry.bound == Bound::LOWER) {
+          alpha = std::max(alpha, entry.value);
+        } else {
+          beta = std::min(beta, entry.value);
+        }
+        if (alpha >= beta) {
+          return entry.value;
+        }
+      }
+    }
+
+    value_t best = -INF;
+    std::size_t best_move = NO_MOVE;
+    for (auto const &candidate : ordered_moves(ply, tt_move)) {
+      make(candidate.idx);
+      value_t const value = -negamax(depth - 1, -beta, -alpha, ply + 1);
+      unmake();
+      if (m_aborted) {
+        return 0;
+      }
+
+      if (value > best) {
+        best = value;
+        best_move = candidate.idx;
+      }
+      alpha = std::max(alpha, value);
+      if (alpha >= beta) {
+        if (candidate.idx != m_killers[ply][0]) {
+          m_killers[ply][1] = m_killers[ply][0];
+          m_killers[ply][0] = candidate.idx;
+        }
+        break;
+      }
+    }
+
+    Bound bound = Bound::EXACT;
+    if (best <= alpha_orig) {
+      bound = Bound::UPPER;
+    } else if (best >= beta) {
+      bound = Bound::LOWER;
+    }
+    entry = {key, best, best_move, depth, bound};
+    return best;
+  }
+
+  // searches the root moves in the order of the previous iteration, and moves
+  // the best one to the front; returns false if the search was aborted
+  bool search_root(std::size_t depth) {
+    value_t alpha = -INF;
+    std::size_t best = 0;
+    for (std::size_t idx = 0; idx < m_root_moves.size(); ++idx) {
+      make(m_root_moves[idx]);
+      value_t const value = -negamax(depth - 1, -INF, -alpha, 1);
+      unmake();
+      if (m_aborted) {
+        return false;
+      }
+      if (value > alpha) {
+        alpha = value;
+        best = idx;
+      }
+    }
+    std::rotate(
+        m_root_moves.begin(),
+        m_root_moves.begin() + static_cast<std::ptrdiff_t>(best),
+        m_root_moves.begin() + static_cast<std::ptrdiff_t>(best) + 1);
+    return true;
+  }
+
+public:
+  explicit FPlayerAlphaBeta(Player player, SearchLimits limits = {})
+      : FPlayer(player, PLAYER_NAME, VERSION, FIRSTNAME, LASTNAME),
+        m_limits(limits),
+        m_endgame(limits.tt_size_log2),
+        m_table(std::size_t{1} << limits.tt_size_log2) {}
+
+  void initialize(FacilityGame const &game) override {
+    m_board.reset();
+    m_endgame.clear();
+    std::ranges::fill(m_table, TTEntry{});
+    m_total_stats = {};
+    sync(game);
+  }
+
+  std::size_t next_move(FacilityGame const &game) override {
+    auto const start = clock_t::now();
+    m_deadline = start + m_limits.max_time;
+    m_aborted = false;
+    m_stats = {};
+    sync(game);
+
+    if (m_board->num_free() <= m_limits.endgame_free) {
+      if (auto result =
+              m_endgame.solve(*m_board, m_limits.endgame_max_nodes)) {
+        m_stats.nodes = m_endgame.get_stats().nodes;
+        m_stats.time = clock_t::now() - start;
+        m_total_stats.nodes += m_stats.nodes;
+        m_total_stats.time += m_stats.time;
+        return result->move;
+      }
+    }
+
+    m_root_moves.clear();
+    for (auto const &candidate : ordered_moves(0, NO_MOVE)) {
+      m_root_moves.push_back(candidate.idx);
+    }
+    if (m_root_moves.empty()) {
+      throw FacilityGameException("No available move");
+    }
+
+    // once the depth reaches the number of free nodes every line searched
+    // ends the game, so a deeper search finds nothing new; it is still not
+    // exact, since only max_width moves are searched at every node
+    std::size_t const max_depth =
+        std::min(m_limits.max_depth, m_board->num_free());
+    for (std::size_t depth = 1; depth <= max_depth; ++depth) {
+      if (!search_root(depth)) {
+        break;
+      }
+      m_stats.depth = depth;
+    }
+
+    m_stats.time = clock_t::now() - start;
+    m_total_stats.nodes += m_stats.nodes;
+    m_total_stats.depth = std::max(m_total_stats.depth, m_stats.depth);
+    m_total_stats.time += m_stats.time;
+    return m_root_moves.front();
+  }
+
+  // the search stops at the next time check, with the best move found so far
+  void request_stop() override {
+    m_stop_requested.store(true, std::memory_order_relaxed);
+  }
+
+  // the statistics of the last search
+  [[nodiscard]] SearchStats const &get_stats() const {
+    return m_stats;
+  }
+
+  // the statistics of all the searches since initialize
+  [[nodiscard]] SearchStats const &get_total_stats() const {
+    return m_total_stats;
+  }
+};
+
+#endif // FPLAYER_ALPHA_BETA_H
@@ -1,12 +1,10 @@
 #ifndef FPLAYER_SIMPLE1_H
 #define FPLAYER_SIMPLE1_H
 
-#include <algorithm>
-
 #include "FPlayer.h"
 #include "FacilityGameException.h"
 
-class FPlayerLinear : public FPlayer {
+class FPlayerLinear final : public FPlayer {
 private:
   static constexpr char const *PLAYER_NAME = "SimpleFPlayer1";
   static constexpr char const *VERSION = "1.2";
@@ -21,14 +19,13 @@ public:
 
   // return the first free node
   std::size_t next_move(FacilityGame const &game) override {
-    auto const &statuses = game.get_statuses();
-    auto it = std::ranges::find(statuses, FacilityStatus::FREE);
+    std::size_t const idx = game.get_statuses().find_first_free();
 
-    if (it == statuses.end()) {
+    if (idx == game.get_num_nodes()) {
       throw FacilityGameException("No available move");
     }
 
-    return static_cast<std::size_t>(std::distance(statuses.begin(), it));
+    return idx;
   }
 };
 
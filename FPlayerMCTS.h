@@ -0,0 +1,302 @@
+#ifndef FPLAYER_MCTS_H
+#define FPLAYER_MCTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <future>
+#include <limits>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include "FPlayer.h"
+#include "FacilityGameException.h"
+#include "PlayoutState.h"
+#include "ThreadPool.h"
+
+struct MCTSLimits {
+  std::size_t num_threads{ThreadPool::default_num_threads()};
+  // a playout budget makes the search deterministic for a given number of
+  // threads, unlike the time budget
+  std::size_t max_playouts{std::numeric_limits<std::size_t>::max()};
+  std::chrono::milliseconds max_time{100};
+  // the number of children of a tree node, ordered by their gain
+  std::size_t max_children{24};
+  double exploration{1.0};
+  std::uint64_t seed{};
+};
+
+struct MCTSStats {
+  std::size_t playouts{};
+  std::chrono::nanoseconds time{};
+
+  [[nodiscard]] double playouts_per_sec() const {
+    return static_cast<double>(playouts)
+           / std::chrono::duration<double>(time).count();
+  }
+};
+
+// Monte Carlo Tree Search with UCT and root parallelism: every thread grows
+// its own tree on its own copy of the board, and the visits of the root moves
+// are summed over the trees to pick the move. Playouts run on a PlayoutState
+// with uniformly random moves.
+class FPlayerMCTS final : public FPlayer {
+private:
+  static constexpr char const *PLAYER_NAME = "MCTS";
+  static constexpr char const *VERSION = "1.0";
+  static constexpr char const *FIRSTNAME = "";
+  static constexpr char const *LASTNAME = "";
+
+  using clock_t = std::chrono::steady_clock;
+
+  struct TreeNode {
+    std::size_t move{};
+    std::size_t first_child{};
+    std::size_t num_children{};
+    std::size_t visits{};
+    // the sum of the rewards of the player who made the move
+    double reward{};
+    bool expanded{};
+  };
+
+  struct Candidate {
+    std::size_t idx;
+    std::size_t gain;
+  };
+
+  // everything a thread needs to search without sharing
+  struct Worker {
+    std::optional<FacilityGame> board;
+    std::vector<TreeNode> tree;
+    std::vector<std::size_t> path;
+    std::vector<Candidate> candidates;
+    PlayoutState playout;
+    std::mt19937_64 gen;
+    std::size_t playouts{};
+  };
+
+  MCTSLimits m_limits;
+  ThreadPool m_pool;
+  std::vector<Worker> m_workers;
+  std::size_t m_num_moves{};
+  MCTSStats m_stats;
+  MCTSStats m_total_stats;
+  std::atomic<bool> m_stop_requested{};
+
+  static void sync(Worker &worker, FacilityGame const &game) {
+    auto const &moves = game.get_moves();
+    if (!worker.board || worker.board->get_moves().size() > moves.size()) {
+      worker.board = game;
+      worker.board->clear();
+    }
+    for (std::size_t idx = worker.board->get_moves().size();
+         idx < moves.size();
+         ++idx) {
+      worker.board->append_move(
+          worker.board->get_player_to_move(),
+          moves[idx]);
+    }
+  }
+
+  // adds the free nodes with the highest gain as children of the node
+  void expand(Worker &worker, std::size_t node) {
+    FacilityGame &board = *worker.board;
+    Player const me = board.get_player_to_move();
+    std::size_t const score = board.get_score(me);
+    auto const &statuses = board.get_statuses();
+
+    worker.candidates.clear();
+    for (std::size_t idx = statuses.find_first_free(); idx < statuses.size();
+         idx = statuses.find_first_free(idx + 1)) {
+      board.append_move(me, idx);
+      worker.candidates.push_back({idx, board.get_score(me) - score});
+      board.undo_move();
+    }
+
+    auto const width =
+        std::min(worker.candidates.size(), m_limits.max_children);
+    std::partial_sort(
+        worker.candidates.begin(),
+        worker.candidates.begin() + static_cast<std::ptrdiff_t>(width),
+        worker.candidates.end(),
+        [](Candidate const &lhs, Candidate const &rhs) {
+          return lhs.gain > rhs.gain
+                 || (lhs.gain == rhs.gain && lhs.idx < rhs.idx);
+        });
+
+    worker.tree[node].expanded = true;
+    worker.tree[node].first_child = worker.tree.size();
+    worker.tree[node].num_children = width;
+    for (std::size_t idx = 0; idx < width; ++idx) {
+      worker.tree.push_back({.move = worker.candidates[idx].idx});
+    }
+  }
+
+  // the child with the highest UCT value; unvisited children come first, in
+  // the order of their gain
+  [[nodiscard]] std::size_t select(
+      Worker const &worker,
+      std::size_t node) const {
+    TreeNode const &parent = worker.tree[node];
+    double const log_visits = std::log(static_cast<double>(parent.visits));
+    std::size_t best = parent.first_child;
+    double best_value = -1;
+    for (std::size_t child = parent.first_child;
+         child < parent.first_child + parent.num_children;
+         ++child) {
+      TreeNode const &tree_node = worker.tree[child];
+      if (tree_node.visits == 0) {
+        return child;
+      }
+      auto const visits = static_cast<double>(tree_node.visits);
+      double const value = tree_node.reward / visits
+                           + m_limits.exploration
+                                 * std::sqrt(log_visits / visits);
+      if (value > best_value) {
+        best_value = value;
+        best = child;
+      }
+    }
+    return best;
+  }
+
+  void iterate(Worker &worker) {
+    FacilityGame &board = *worker.board;
+    Player const me = board.get_player_to_move();
+
+    // selection and expansion
+    std::size_t node = 0;
+    worker.path.assign(1, node);
+    while (!board.is_finished()) {
+      if (!worker.tree[node].expanded) {
+        expand(worker, node);
+      }
+      node = select(worker, node);
+      board.append_move(board.get_player_to_move(), worker.tree[node].move);
+      worker.path.push_back(node);
+      if (worker.tree[node].visits == 0) {
+        break;
+      }
+    }
+
+    // simulation
+    worker.playout.assign(board);
+    worker.playout.play_random(worker.gen);
+    auto const [score_a, score_b] = worker.playout.scores();
+    auto const [mine, theirs] = me == Player::PLAYER_A
+                                    ? std::pair{score_a, score_b}
+                                    : std::pair{score_b, score_a};
+    double reward = 0.5;
+    if (mine > theirs) {
+      reward = 1;
+    } else if (mine < theirs) {
+      reward = 0;
+    }
+
+    // backpropagation, the moves at odd depths are mine
+    for (std::size_t depth = 0; depth < worker.path.size(); ++depth) {
+      TreeNode &tree_node = worker.tree[worker.path[depth]];
+      ++tree_node.visits;
+      tree_node.reward += depth % 2 == 1 ? reward : 1 - reward;
+    }
+    for (std::size_t depth = 1; depth < worker.path.size(); ++depth) {
+      board.undo_move();
+    }
+    ++worker.playouts;
+  }
+
+  void search(
+      Worker &worker,
+      std::size_t max_playouts,
+      clock_t::time_point deadline) {
+    worker.tree.assign(1, TreeNode{});
+    worker.playouts = 0;
+    while (worker.playouts < max_playouts
+           && (worker.playouts == 0
+               || (clock_t::now() < deadline
+                   && !m_stop_requested.load(std::memory_order_relaxed)))) {
+      iterate(worker);
+    }
+  }
+
+public:
+  explicit FPlayerMCTS(Player player, MCTSLimits limits = {})
+      : FPlayer(player, PLAYER_NAME, VERSION, FIRSTNAME, LASTNAME),
+        m_limits(limits),
+        m_pool(limits.num_threads),
+        m_workers(m_pool.num_threads()) {}
+
+  void initialize([[maybe_unused]] FacilityGame const &game) override {
+    for (std::size_t idx = 0; idx < m_workers.size(); ++idx) {
+      m_workers[idx].board.reset();
+      m_workers[idx].gen.seed(m_limits.seed + idx);
+    }
+    m_total_stats = {};
+  }
+
+  std::size_t next_move(FacilityGame const &game) override {
+    if (game.is_finished()) {
+      throw FacilityGameException("No available move");
+    }
+
+    auto const start = clock_t::now();
+    auto const deadline = start + m_limits.max_time;
+    std::size_t const max_playouts = std::max<std::size_t>(
+        m_limits.max_playouts / m_workers.size(),
+        1);
+
+    m_pool.parallel_for(m_workers.size(), [&](std::size_t idx) {
+      sync(m_workers[idx], game);
+      search(m_workers[idx], max_playouts, deadline);
+    });
+
+    // sum the visits of the root moves over all the trees; the root moves are
+    // the same in every tree, since they are ordered by their gain
+    Worker const &first = m_workers.front();
+    TreeNode const &root = first.tree.front();
+    std::size_t best = root.first_child;
+    std::size_t best_visits = 0;
+    for (std::size_t child = root.first_child;
+         child < root.first_child + root.num_children;
+         ++child) {
+      std::size_t visits = 0;
+      for (auto const &worker : m_workers) {
+        visits += worker.tree[child].visits;
+      }
+      if (visits > best_visits) {
+        best_visits = visits;
+        best = child;
+      }
+    }
+
+    m_stats = {};
+    for (auto const &worker : m_workers) {
+      m_stats.playouts += worker.playouts;
+    }
+    m_stats.time = clock_t::now() - start;
+    m_total_stats.playouts += m_stats.playouts;
+    m_total_stats.time += m_stats.time;
+    return first.tree[best].move;
+  }
+
+  // the workers stop after their current playout, and every later search
+  // plays a single one
+  void request_stop() override {
+    m_stop_requested.store(true, std::memory_order_relaxed);
+  }
+
+  // the statistics of the last search
+  [[nodiscard]] MCTSStats const &get_stats() const {
+    return m_stats;
+  }
+
+  // the statistics of all the searches since initialize
+  [[nodiscard]] MCTSStats const &get_total_stats() const {
+    return m_total_stats;
+  }
+};
+
+#endif // FPLAYER_MCTS_H
@@ -6,7 +6,7 @@
 #include "FPlayer.h"
 #include "FacilityGameException.h"
 
-class FPlayerRandom : public FPlayer {
+class FPlayerRandom final : public FPlayer {
 private:
   static constexpr char const *PLAYER_NAME = "SimpleFPlayer2";
   static constexpr char const *VERSION = "1.4";
@@ -1,14 +1,15 @@
 #ifndef FPLAYER_SLOW_H
 #define FPLAYER_SLOW_H
 
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 #include <random>
-#include <ranges>
-#include <thread>
 
 #include "FPlayer.h"
 #include "FacilityGameException.h"
 
-class FPlayerSlow : public FPlayer {
+class FPlayerSlow final : public FPlayer {
   static constexpr char const *playerName = "SlowPlayer";
   static constexpr char const *version = "1.0";
   static constexpr char const *firstname = "Data";
@@ -19,6 +20,9 @@ class FPlayerSlow : public FPlayer {
 
   std::mt19937_64 m_gen;
   std::uniform_int_distribution<uint64_t> m_dist;
+  std::mutex m_mtx;
+  std::condition_variable m_cv;
+  bool m_stop_requested{};
 
 public:
   explicit FPlayerSlow(Player player)
@@ -30,18 +34,28 @@ public:
 
   std::size_t next_move(FacilityGame const &game) override {
     // make the player slow and check what happens
-    std::this_thread::sleep_for(std::chrono::seconds(m_dist(m_gen)));
+    {
+      std::unique_lock lock(m_mtx);
+      m_cv.wait_for(lock, std::chrono::seconds(m_dist(m_gen)), [this]() {
+        return m_stop_requested;
+      });
+    }
 
-    auto it = std::ranges::find(
-        game.get_statuses() | std::views::reverse,
-        FacilityStatus::FREE);
-    if (it == game.get_statuses().rend()) {
+    std::size_t const idx = game.get_statuses().find_last_free();
+    if (idx == game.get_num_nodes()) {
       throw FacilityGameException("No available move");
     }
 
-    auto const distance = static_cast<std::size_t>(
-        std::distance(game.get_statuses().rbegin(), it));
-    return game.get_num_nodes() - distance - 1;
+    return idx;
+  }
+
+  // wakes the player up from its sleep
+  void request_stop() override {
+    {
+      std::scoped_lock sl(m_mtx);
+      m_stop_requested = true;
+    }
+    m_cv.notify_all();
   }
 };
 
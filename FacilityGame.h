@@ -2,11 +2,22 @@
 #define FACILITY_GAME_H
 
 #include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cstdint>
 #include <fmt/base.h>
+#include <limits>
+#include <memory>
+#include <optional>
 #include <random>
-#include <ranges>
+#include <span>
+#include <string>
+#include <type_traits>
 
 #include "FacilityGameException.h"
+#include "GameScore.h"
+#include "HighestFreeIndex.h"
+#include "PackedStatuses.h"
 #include "enums.h"
 
 static constexpr std::size_t MIN_VALUE = 10;
@@ -14,32 +25,107 @@ static constexpr std::size_t MAX_VALUE = 50;
 static constexpr std::size_t BONUS_MIN_GROUP_SIZE = 3;
 static constexpr std::size_t BONUS_FACTOR = 3;
 
-class FacilityGame {
+// the smallest unsigned type which holds the values up to MaxValue
+template <std::size_t MaxValue>
+using node_value_t = std::conditional_t<
+    MaxValue <= std::numeric_limits<std::uint8_t>::max(),
+    std::uint8_t,
+    std::conditional_t<
+        MaxValue <= std::numeric_limits<std::uint16_t>::max(),
+        std::uint16_t,
+        std::conditional_t<
+            MaxValue <= std::numeric_limits<std::uint32_t>::max(),
+            std::uint32_t,
+            std::uint64_t>>>;
+
+// The node values are stored as Node, by default the smallest type which
+// holds MAX_VALUE, while the scores are std::size_t. The players, the
+// registry and the board files work on FacilityGame, i.e. the default Node;
+// the other node types are only for the engine on its own.
+template <typename Node = node_value_t<MAX_VALUE>>
+class BasicFacilityGame {
+  static_assert(std::is_unsigned_v<Node>);
+  static_assert(std::numeric_limits<Node>::max() >= MAX_VALUE);
+
 private:
+  // a scoring group is a maximal run of one player's nodes, where BLOCKED
+  // nodes are skipped; the record is only valid at the two ends of a group
+  struct Group {
+    std::size_t other_end;
+    std::size_t sum;
+    std::size_t size;
+  };
+
+  // what undo_move needs to restore the state before a move: the neighbors
+  // the move blocked, the group records it overwrote and the mover's score
+  struct Undo {
+    bool blocked_left;
+    bool blocked_right;
+    std::size_t first;
+    std::size_t last;
+    Group first_group;
+    Group last_group;
+    std::size_t score;
+  };
+
   std::size_t m_seed;
-  std::vector<std::size_t> m_nodes;
-  std::vector<FacilityStatus> m_statuses;
+  // the node values are read-only and shared by the copies of a game; they
+  // are either generated from the seed or owned by something else, e.g. a
+  // memory-mapped board file
+  std::shared_ptr<void const> m_nodes_owner;
+  std::span<Node const> m_nodes;
+  PackedStatuses m_statuses;
   std::vector<std::size_t> m_moves;
+  std::size_t m_num_free;
+  // allocated by the first move, so that opening a board costs nothing per
+  // node
+  std::vector<Group> m_groups;
+  GameScore m_score;
+  std::vector<Undo> m_undo;
+  // Zobrist hash of the statuses and the player to move
+  std::uint64_t m_hash{};
+  // built by the first query, since only some players use it
+  mutable std::optional<HighestFreeIndex<MAX_VALUE>> m_highest;
 
   // player_A plays first, player_B plays second
 
 public:
-  FacilityGame(std::size_t size, std::size_t seed)
+  using node_t = Node;
+
+  BasicFacilityGame(std::size_t size, std::size_t seed)
+      : BasicFacilityGame(generate_nodes(size, seed), seed) {}
+
+  // a game over node values which owner keeps alive
+  BasicFacilityGame(
+      std::shared_ptr<void const> owner,
+      std::span<Node const> nodes,
+      std::size_t seed)
       : m_seed(seed),
-        m_nodes(size),
-        m_statuses(size) {
-    std::mt19937 gen(m_seed);
+        m_nodes_owner(std::move(owner)),
+        m_nodes(nodes),
+        m_statuses(nodes.size()),
+        m_num_free(nodes.size()) {}
+
+  // the node values of the board with this seed, e.g. to play it outside of
+  // a FacilityGame
+  static void fill_nodes(std::span<Node> nodes, std::size_t seed) {
+    std::mt19937 gen(seed);
     std::uniform_int_distribution<std::size_t> dist(1, MAX_VALUE);
-    std::generate(m_nodes.begin(), m_nodes.end(), [&gen, &dist]() {
-      return dist(gen);
+    std::ranges::generate(nodes, [&gen, &dist]() {
+      return static_cast<Node>(dist(gen));
     });
   }
 
   void clear() {
-    for (auto &status : m_statuses) {
-      status = FacilityStatus::FREE;
-    }
+    m_statuses.clear();
     m_moves.clear();
+    m_undo.clear();
+    m_hash = 0;
+    m_num_free = m_nodes.size();
+    m_score = {};
+    if (m_highest) {
+      m_highest->clear();
+    }
   }
 
   [[nodiscard]] std::size_t get_num_nodes() const {
@@ -54,7 +140,7 @@ public:
     return m_nodes[node_idx];
   }
 
-  [[nodiscard]] std::vector<std::size_t> const &get_nodes() const {
+  [[nodiscard]] std::span<Node const> get_nodes() const {
     return m_nodes;
   }
 
@@ -62,24 +148,63 @@ public:
     return m_statuses[node_idx];
   }
 
-  [[nodiscard]] std::vector<FacilityStatus> const &get_statuses() const {
+  [[nodiscard]] PackedStatuses const &get_statuses() const {
     return m_statuses;
   }
 
   [[nodiscard]] std::size_t get_score(Player const &player) const {
-    return compute_score(player);
+    assert(m_score.get_score(player) == compute_score(player));
+    return m_score.get_score(player);
+  }
+
+  [[nodiscard]] std::size_t num_free() const {
+    assert(m_num_free == count_free());
+    return m_num_free;
   }
 
   [[nodiscard]] bool is_finished() const {
-    return !std::ranges::any_of(m_statuses, [](FacilityStatus status) {
-      return status == FacilityStatus::FREE;
-    });
+    return num_free() == 0;
   }
 
   [[nodiscard]] std::vector<std::size_t> const &get_moves() const {
     return m_moves;
   }
 
+  // equal positions have equal hashes, whatever the order of the moves
+  [[nodiscard]] std::uint64_t get_hash() const {
+    return m_hash;
+  }
+
+  // the FREE node with the highest value, the leftmost one on ties, in O(1)
+  // amortized over a game
+  [[nodiscard]] std::optional<std::size_t> highest_free() const {
+    if (!m_highest) {
+      m_highest.emplace(m_nodes);
+    }
+    auto const idx = m_highest->highest_free(m_statuses);
+    assert(idx == find_highest_free());
+    return idx;
+  }
+
+  // the player whose turn it is
+  [[nodiscard]] Player get_player_to_move() const {
+    return m_moves.size() % 2 == 0 ? Player::PLAYER_A : Player::PLAYER_B;
+  }
+
+  // the sum and the size of the scoring group of an occupied node, which
+  // must be the first or the last node of its group, e.g. the closest
+  // occupied node before or after a run of FREE nodes
+  [[nodiscard]] std::pair<std::size_t, std::size_t> get_group(
+      std::size_t idx) const {
+    return {m_groups[idx].sum, m_groups[idx].size};
+  }
+
+  // the other end of the scoring group of an occupied node, which must be
+  // the first or the last node of its group
+  [[nodiscard]] std::size_t get_group_other_end(std::size_t idx) const {
+    return m_groups[idx].other_end;
+  }
+
   bool append_move(Player player, std::size_t idx) {
     if (player == Player::PLAYER_A) {
       if (m_moves.size() % 2 == 1) {
@@ -111,66 +236,259 @@ public:
     }
 
     m_moves.emplace_back(idx);
+    Undo &undo = m_undo.emplace_back();
 
     // occupy the location
-    if (player == Player::PLAYER_A) {
-      m_statuses[idx] = FacilityStatus::PLAYER_A;
-    } else {
-      m_statuses[idx] = FacilityStatus::PLAYER_B;
-    }
+    FacilityStatus const status = player == Player::PLAYER_A
+                                      ? FacilityStatus::PLAYER_A
+                                      : FacilityStatus::PLAYER_B;
+    m_statuses.set(idx, status);
+    m_hash ^= SIDE_KEY ^ zobrist_key(idx, status);
+    --m_num_free;
 
     // block neighbors
     if (m_nodes.size() > 2) {
-      if (idx > 0 && m_statuses[idx - 1] == FacilityStatus::FREE) {
-        m_statuses[idx - 1] = FacilityStatus::BLOCKED;
+      if (idx > 0 && m_statuses.block_if_free(idx - 1)) {
+        undo.blocked_left = true;
+        m_hash ^= zobrist_key(idx - 1, FacilityStatus::BLOCKED);
+        --m_num_free;
       }
-      if (idx < m_nodes.size() - 1
-          && m_statuses[idx + 1] == FacilityStatus::FREE) {
-        m_statuses[idx + 1] = FacilityStatus::BLOCKED;
+      if (idx < m_nodes.size() - 1 && m_statuses.block_if_free(idx + 1)) {
+        undo.blocked_right = true;
+        m_hash ^= zobrist_key(idx + 1, FacilityStatus::BLOCKED);
+        --m_num_free;
       }
     }
 
+    join_groups(player, idx, undo);
+
     return true;
   }
 
+  // takes back the last move in O(1)
+  void undo_move() {
+    if (m_moves.empty()) {
+      throw FacilityGameException("There is no move to undo");
+    }
+
+    std::size_t const idx = m_moves.back();
+    Undo const &undo = m_undo.back();
+    m_moves.pop_back();
+    Player const player = get_player_to_move();
+
+    m_groups[undo.first] = undo.first_group;
+    m_groups[undo.last] = undo.last_group;
+    m_score.set_score(player, undo.score);
+
+    m_hash ^= SIDE_KEY ^ zobrist_key(idx, m_statuses[idx]);
+    m_statuses.set(idx, FacilityStatus::FREE);
+    restore_highest(idx);
+    ++m_num_free;
+    if (undo.blocked_left) {
+      m_hash ^= zobrist_key(idx - 1, FacilityStatus::BLOCKED);
+      m_statuses.set(idx - 1, FacilityStatus::FREE);
+      restore_highest(idx - 1);
+      ++m_num_free;
+    }
+    if (undo.blocked_right) {
+      m_hash ^= zobrist_key(idx + 1, FacilityStatus::BLOCKED);
+      m_statuses.set(idx + 1, FacilityStatus::FREE);
+      restore_highest(idx + 1);
+      ++m_num_free;
+    }
+
+    m_undo.pop_back();
+  }
+
 private:
-  [[nodiscard]] std::size_t compute_score(Player player) const {
-    FacilityStatus const search_status = player == Player::PLAYER_A
-                                             ? FacilityStatus::PLAYER_A
-                                             : FacilityStatus::PLAYER_B;
-    std::size_t tmp_score{0};
-    std::size_t num_consecutive{0};
-    std::size_t score{0};
+  static constexpr std::uint64_t SIDE_KEY = 0x9e3779b97f4a7c15ULL;
+
+  BasicFacilityGame(
+      std::shared_ptr<std::vector<Node> const> nodes,
+      std::size_t seed)
+      : BasicFacilityGame(nodes, std::span<Node const>(*nodes), seed) {}
+
+  [[nodiscard]] static std::shared_ptr<std::vector<Node> const> generate_nodes(
+      std::size_t size,
+      std::size_t seed) {
+    auto nodes = std::make_shared<std::vector<Node>>(size);
+    fill_nodes(*nodes, seed);
+    return nodes;
+  }
 
-    for (std::size_t idx = 0; idx < m_nodes.size(); ++idx) {
-      auto const &status = m_statuses[idx];
-      auto const &node = m_nodes[idx];
-
-      if (status == search_status) {
-        ++num_consecutive;
-        tmp_score += node;
-      } else if (status == FacilityStatus::BLOCKED) {
-        continue;
-      } else {
-        if (num_consecutive >= BONUS_MIN_GROUP_SIZE) {
-          tmp_score *= BONUS_FACTOR;
-        }
-        score += tmp_score;
-        tmp_score = 0;
-        num_consecutive = 0;
+  // the random key of a node with a non-FREE status; the keys are generated
+  // by splitmix64 on the fly instead of being stored, since a table would
+  // need 24 bytes per node
+  [[nodiscard]] static std::uint64_t zobrist_key(
+      std::size_t idx,
+      FacilityStatus status) {
+    std::uint64_t z = (idx << 2U) | static_cast<unsigned>(status);
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31U);
+  }
+
+  // full scan, used to cross-check m_num_free in debug builds
+  [[nodiscard]] std::size_t count_free() const {
+    return m_statuses.count(FacilityStatus::FREE);
+  }
+
+  // reference for highest_free()
+  [[nodiscard]] std::optional<std::size_t> find_highest_free() const {
+    std::optional<std::size_t> best;
+    for (std::size_t idx = m_statuses.find_first_free(); idx < m_nodes.size();
+         idx = m_statuses.find_first_free(idx + 1)) {
+      if (!best || m_nodes[idx] > m_nodes[*best]) {
+        best = idx;
       }
     }
-    if (num_consecutive >= BONUS_MIN_GROUP_SIZE) {
-      tmp_score *= BONUS_FACTOR;
+    return best;
+  }
+
+  [[nodiscard]] static std::size_t group_score(
+      std::size_t sum,
+      std::size_t size) {
+    if (size >= BONUS_MIN_GROUP_SIZE) {
+      return sum * BONUS_FACTOR;
     }
-    score += tmp_score;
+    return sum;
+  }
+
+  [[nodiscard]] static std::size_t group_score(Group const &group) {
+    return group_score(group.sum, group.size);
+  }
+
+  // calls on_group(first, last, sum, size) for every scoring group of a
+  // player, from left to right, and returns the score; BLOCKED nodes are
+  // skipped a word at a time, and only the nodes of the player and the nodes
+  // which end a group are visited
+  template <typename OnGroup>
+  std::size_t score_groups(Player player, OnGroup &&on_group) const {
+    Player const opponent = player == Player::PLAYER_A ? Player::PLAYER_B
+                                                       : Player::PLAYER_A;
+    std::size_t first{};
+    std::size_t last{};
+    std::size_t sum{};
+    std::size_t size{};
+    std::size_t score{};
+    auto close = [&]() {
+      if (size > 0) {
+        on_group(first, last, sum, size);
+        score += group_score(sum, size);
+        sum = 0;
+        size = 0;
+      }
+    };
+
+    for (std::size_t word = 0; word < m_statuses.num_words(); ++word) {
+      auto const mine = m_statuses.player_mask(word, player);
+      auto visit = mine | m_statuses.free_mask(word)
+                   | m_statuses.player_mask(word, opponent);
+
+      for (; visit != 0; visit &= visit - 1) {
+        auto const bit = static_cast<std::size_t>(std::countr_zero(visit));
+        std::size_t const idx = word * PackedStatuses::WORD_BITS + bit;
+        if ((mine >> bit) & 1U) {
+          if (size == 0) {
+            first = idx;
+          }
+          last = idx;
+          ++size;
+          sum += m_nodes[idx];
+        } else {
+          close();
+        }
+      }
+    }
+    close();
     return score;
   }
 
+  // the closest node on each side which is not BLOCKED; a BLOCKED node
+  // always has an occupied neighbor, so these walk at most three nodes, e.g.
+  // from the last node of P B B P to the first one
+  [[nodiscard]] std::optional<std::size_t> unblocked_left(
+      std::size_t idx) const {
+    while (idx > 0) {
+      --idx;
+      if (m_statuses[idx] != FacilityStatus::BLOCKED) {
+        return idx;
+      }
+    }
+    return std::nullopt;
+  }
+
+  [[nodiscard]] std::optional<std::size_t> unblocked_right(
+      std::size_t idx) const {
+    while (idx + 1 < m_nodes.size()) {
+      ++idx;
+      if (m_statuses[idx] != FacilityStatus::BLOCKED) {
+        return idx;
+      }
+    }
+    return std::nullopt;
+  }
+
+  void restore_highest(std::size_t idx) {
+    if (m_highest) {
+      m_highest->restore(idx, m_nodes[idx]);
+    }
+  }
+
+  // the newly occupied node idx forms a group on its own, which is merged
+  // with the groups that end right before and start right after it
+  void join_groups(Player player, std::size_t idx, Undo &undo) {
+    FacilityStatus const status = m_statuses[idx];
+    std::size_t score = m_score.get_score(player);
+    undo.score = score;
+    if (m_groups.empty()) {
+      m_groups.resize(m_nodes.size());
+    }
+    Group joined{idx, m_nodes[idx], 1};
+    std::size_t first = idx;
+
+    if (auto left = unblocked_left(idx); left && m_statuses[*left] == status) {
+      Group const &group = m_groups[*left];
+      score -= group_score(group);
+      first = group.other_end;
+      joined.sum += group.sum;
+      joined.size += group.size;
+    }
+    if (auto right = unblocked_right(idx);
+        right && m_statuses[*right] == status) {
+      Group const &group = m_groups[*right];
+      score -= group_score(group);
+      joined.other_end = group.other_end;
+      joined.sum += group.sum;
+      joined.size += group.size;
+    }
+
+    std::size_t const last = joined.other_end;
+    undo.first = first;
+    undo.last = last;
+    undo.first_group = m_groups[first];
+    undo.last_group = m_groups[last];
+    m_groups[last] = {first, joined.sum, joined.size};
+    m_groups[first] = joined;
+    m_score.set_score(player, score + group_score(joined));
+  }
+
 public:
+  // reference implementation of the scoring rules, used to cross-check the
+  // incrementally maintained scores in debug builds
+  [[nodiscard]] std::size_t compute_score(Player player) const {
+    return score_groups(
+        player,
+        []([[maybe_unused]] std::size_t first,
+           [[maybe_unused]] std::size_t last,
+           [[maybe_unused]] std::size_t sum,
+           [[maybe_unused]] std::size_t size) {});
+  }
+
   void print_score() {
-    auto score_A = compute_score(Player::PLAYER_A);
-    auto score_B = compute_score(Player::PLAYER_B);
+    auto score_A = get_score(Player::PLAYER_A);
+    auto score_B = get_score(Player::PLAYER_B);
     fmt::println("SCORE: PLAYER_A:{} PLAYER_B:{}", score_A, score_B);
     if (score_A > score_B) {
       fmt::println("PLAYER_A WINS BY {} POINTS!", score_A - score_B);
@@ -186,7 +504,7 @@ public:
       fmt::print("{:2d} ", idx);
     }
     fmt::println("");
-    for (std::size_t const &node : m_nodes) {
+    for (auto const node : m_nodes) {
       fmt::print("{:2d} ", node);
     }
     fmt::println("");
@@ -196,85 +514,66 @@ public:
     fmt::println("\n");
   }
 
-  void print_score_calculation() const {
-    for (auto player : {Player::PLAYER_A, Player::PLAYER_B}) {
-      std::string detailed;
-      FacilityStatus const search_status = player == Player::PLAYER_A
-                                               ? FacilityStatus::PLAYER_A
-                                               : FacilityStatus::PLAYER_B;
-      std::size_t tmp_score{0};
-      std::size_t num_consecutive{0};
-      std::size_t score{0};
-
-      for (std::size_t idx = 0; idx < m_nodes.size(); ++idx) {
-        auto const status = m_statuses[idx];
-        auto const node = m_nodes[idx];
-
-        if (status == search_status) {
-          ++num_consecutive;
-          tmp_score += node;
-
-          if (num_consecutive == 1) {
-            if (score > 0) {
-              detailed += ' ';
+  // the groups of a player with their sums, bonuses and the total, e.g.
+  // "(12+40+7)*3=177 (25)=25 === 202"
+  [[nodiscard]] std::string score_calculation(Player player) const {
+    FacilityStatus const status = player == Player::PLAYER_A
+                                      ? FacilityStatus::PLAYER_A
+                                      : FacilityStatus::PLAYER_B;
+    std::string detailed;
+    std::size_t const score = score_groups(
+        player,
+        [this, status, &detailed](
+            std::size_t first,
+            std::size_t last,
+            std::size_t sum,
+            std::size_t size) {
+          detailed += detailed.empty() ? "(" : " (";
+          for (std::size_t idx = first; idx <= last; ++idx) {
+            if (m_statuses[idx] == status) {
+              if (idx != first) {
+                detailed += '+';
+              }
+              detailed += std::to_string(m_nodes[idx]);
             }
-            detailed += '(';
-          } else {
-            detailed += '+';
           }
-          detailed += std::to_string(node);
-        } else if (status == FacilityStatus::BLOCKED) {
-          continue;
-        } else if (num_consecutive > 0) {
           detailed += ')';
-          if (num_consecutive >= BONUS_MIN_GROUP_SIZE) {
-            tmp_score *= BONUS_FACTOR;
+          if (size >= BONUS_MIN_GROUP_SIZE) {
             detailed += '*' + std::to_string(BONUS_FACTOR);
           }
-          score += tmp_score;
-          detailed += '=' + std::to_string(tmp_score);
-
-          tmp_score = 0;
-          num_consecutive = 0;
-        }
-      }
-      if (num_consecutive > 0) {
-        detailed += ')';
-        if (num_consecutive >= BONUS_MIN_GROUP_SIZE) {
-          tmp_score *= BONUS_FACTOR;
-          detailed += '*' + std::to_string(BONUS_FACTOR);
-        }
-        score += tmp_score;
-        detailed += '=' + std::to_string(tmp_score);
-      }
+          detailed += '=' + std::to_string(group_score(sum, size));
+        });
+    detailed += " === " + std::to_string(score);
+    return detailed;
+  }
 
-      detailed += " === " + std::to_string(score);
-      fmt::println("{}: {}", player_to_str(player), detailed);
+  void print_score_calculation() const {
+    for (auto player : {Player::PLAYER_A, Player::PLAYER_B}) {
+      fmt::println("{}: {}", player_to_str(player), score_calculation(player));
     }
   }
 
   void print_num_moves() const {
-    std::size_t num_moves_A{};
-    std::size_t num_moves_B{};
-    for (auto const &status : m_statuses) {
-      if (status == FacilityStatus::PLAYER_A) {
-        ++num_moves_A;
-      } else if (status == FacilityStatus::PLAYER_B) {
-        ++num_moves_B;
-      }
-    }
+    std::size_t const num_moves_A = m_statuses.count(FacilityStatus::PLAYER_A);
+    std::size_t const num_moves_B = m_statuses.count(FacilityStatus::PLAYER_B);
     fmt::println("MOVES: PLAYER_A:{} PLAYER_B:{}", num_moves_A, num_moves_B);
   }
 
   void print(bool verbose = false) {
     if (verbose) {
-      for (auto [idx, node, status] :
-           std::views::zip(std::views::iota(0), m_nodes, m_statuses)) {
-        fmt::println("{}: {} {}", idx, node, status_to_str(status));
+      for (std::size_t idx = 0; idx < m_nodes.size(); ++idx) {
+        fmt::println(
+            "{}: {} {}",
+            idx,
+            m_nodes[idx],
+            status_to_str(m_statuses[idx]));
       }
     }
     print_score();
     print_num_moves();
   }
 };
+
+using FacilityGame = BasicFacilityGame<>;
+
 #endif // FACILITY_GAME_H
@@ -0,0 +1,124 @@
+#ifndef HIGHEST_FREE_INDEX_H
+#define HIGHEST_FREE_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "PackedStatuses.h"
+
+// The FREE node with the highest value, and the smallest index among those
+// with that value. The node values are bounded, so the nodes are bucketed by
+// value with a counting sort, each bucket in increasing index order, and
+// every bucket has a cursor before which no node is FREE. Deletion is lazy:
+// playing a move costs nothing, and a query moves the cursors forward past
+// the nodes which are not FREE any more, so a whole game of queries visits
+// every node once. A node freed by an undo moves the cursor of its bucket
+// back. The cursors are updated by the const query, so a game must not be
+// queried from several threads at once.
+template <std::size_t MaxValue>
+class HighestFreeIndex {
+private:
+  // the nodes sorted by value, then by index; the nodes with value v are in
+  // [m_begin[v], m_begin[v + 1]); only one of the two is used, the 32-bit
+  // one unless the board has more than 2^32 nodes
+  std::vector<std::uint32_t> m_order32;
+  std::vector<std::uint64_t> m_order64;
+  std::array<std::size_t, MaxValue + 2> m_begin{};
+  mutable std::array<std::size_t, MaxValue + 1> m_cursor{};
+  // no bucket above this value has a FREE node
+  mutable std::size_t m_top{};
+
+  [[nodiscard]] std::size_t end(std::size_t value) const {
+    return m_begin[value + 1];
+  }
+
+  [[nodiscard]] std::size_t order(std::size_t pos) const {
+    return m_order64.empty() ? m_order32[pos]
+                             : static_cast<std::size_t>(m_order64[pos]);
+  }
+
+  template <typename Order, typename Nodes>
+  void sort(Order &order, Nodes const &nodes) {
+    order.resize(nodes.size());
+    auto next = m_begin;
+    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
+      order[next[static_cast<std::size_t>(nodes[idx])]++] =
+          static_cast<typename Order::value_type>(idx);
+    }
+  }
+
+  // the first position in [first, last) of order whose node is not before
+  // idx
+  template <typename Order>
+  [[nodiscard]] static std::size_t lower_bound(
+      Order const &order,
+      std::size_t first,
+      std::size_t last,
+      std::size_t idx) {
+    return static_cast<std::size_t>(
+        std::lower_bound(
+            order.begin() + static_cast<std::ptrdiff_t>(first),
+            order.begin() + static_cast<std::ptrdiff_t>(last),
+            idx)
+        - order.begin());
+  }
+
+public:
+  template <typename Nodes>
+  explicit HighestFreeIndex(Nodes const &nodes) {
+    for (auto const value : nodes) {
+      ++m_begin[static_cast<std::size_t>(value) + 1];
+    }
+    for (std::size_t value = 1; value < m_begin.size(); ++value) {
+      m_begin[value] += m_begin[value - 1];
+    }
+    if (nodes.size()
+        <= std::size_t{std::numeric_limits<std::uint32_t>::max()} + 1) {
+      sort(m_order32, nodes);
+    } else {
+      sort(m_order64, nodes);
+    }
+    clear();
+  }
+
+  // all the nodes are FREE
+  void clear() {
+    std::copy_n(m_begin.begin(), m_cursor.size(), m_cursor.begin());
+    m_top = MaxValue;
+  }
+
+  // the node idx with this value is FREE again
+  void restore(std::size_t idx, std::size_t value) {
+    if (m_cursor[value] == end(value) || idx < order(m_cursor[value])) {
+      m_cursor[value] =
+          m_order64.empty()
+              ? lower_bound(m_order32, m_begin[value], m_cursor[value], idx)
+              : lower_bound(m_order64, m_begin[value], m_cursor[value], idx);
+    }
+    m_top = std::max(m_top, value);
+  }
+
+  [[nodiscard]] std::optional<std::size_t> highest_free(
+      PackedStatuses const &statuses) const {
+    while (true) {
+      auto &cursor = m_cursor[m_top];
+      while (cursor < end(m_top)
+             && statuses[order(cursor)] != FacilityStatus::FREE) {
+        ++cursor;
+      }
+      if (cursor < end(m_top)) {
+        return order(cursor);
+      }
+      if (m_top == 0) {
+        return std::nullopt;
+      }
+      --m_top;
+    }
+  }
+};
+
+#endif // HIGHEST_FREE_INDEX_H
@@ -0,0 +1,119 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+// A histogram of durations in nanoseconds with a bounded relative error, in
+// the style of HdrHistogram: the values below 2^SUB_BITS have a bucket each,
+// and every power of 2 above is split into 2^SUB_BITS buckets, so a bucket is
+// at most 1/32 of its values wide. The counts are relaxed atomics, so any
+// number of threads can record at once without a lock, and recording is a
+// few instructions; the percentiles are read from a snapshot.
+class LatencyHistogram {
+public:
+  static constexpr unsigned SUB_BITS = 5;
+  static constexpr std::uint64_t SUB_COUNT = std::uint64_t{1} << SUB_BITS;
+  static constexpr std::size_t NUM_BUCKETS = (64 - SUB_BITS + 1) * SUB_COUNT;
+
+  [[nodiscard]] static std::size_t bucket(std::uint64_t value) {
+    if (value < SUB_COUNT) {
+      return value;
+    }
+    auto const shift =
+        static_cast<unsigned>(std::bit_width(value)) - SUB_BITS - 1;
+    return (shift + 1) * SUB_COUNT + ((value >> shift) - SUB_COUNT);
+  }
+
+  // the largest value in the bucket
+  [[nodiscard]] static std::uint64_t bucket_max(std::size_t idx) {
+    std::size_t const row = idx / SUB_COUNT;
+    std::uint64_t const col = idx % SUB_COUNT;
+    if (row == 0) {
+      return col;
+    }
+    return ((SUB_COUNT + col + 1) << (row - 1)) - 1;
+  }
+
+  // the counts at one point in time; snapshots of several histograms can be
+  // added up
+  struct Snapshot {
+    std::array<std::uint64_t, NUM_BUCKETS> counts{};
+    std::uint64_t count{};
+    std::uint64_t sum{};
+    std::uint64_t max{};
+
+    Snapshot &operator+=(Snapshot const &other) {
+      for (std::size_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+        counts[idx] += other.counts[idx];
+      }
+      count += other.count;
+      sum += other.sum;
+      max = std::max(max, other.max);
+      return *this;
+    }
+
+    // the value at or below which the fraction q of the values are, at most
+    // 1/32 above the exact one
+    [[nodiscard]] std::uint64_t percentile(double q) const {
+      if (count == 0) {
+        return 0;
+      }
+      auto const rank = std::max<std::uint64_t>(
+          1,
+          static_cast<std::uint64_t>(
+              std::ceil(q * static_cast<double>(count))));
+      std::uint64_t seen{};
+      for (std::size_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+        seen += counts[idx];
+        if (seen >= rank) {
+          return std::min(bucket_max(idx), max);
+        }
+      }
+      return max;
+    }
+
+    [[nodiscard]] double mean() const {
+      return count == 0 ? 0.0
+                        : static_cast<double>(sum) / static_cast<double>(count);
+    }
+  };
+
+private:
+  std::array<std::atomic<std::uint64_t>, NUM_BUCKETS> m_counts{};
+  std::atomic<std::uint64_t> m_sum{};
+  std::atomic<std::uint64_t> m_max{};
+
+public:
+  void record(std::chrono::nanoseconds time) {
+    auto const value =
+        static_cast<std::uint64_t>(std::max<std::int64_t>(time.count(), 0));
+    m_counts[bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(value, std::memory_order_relaxed);
+    auto max = m_max.load(std::memory_order_relaxed);
+    while (value > max
+           && !m_max.compare_exchange_weak(
+               max,
+               value,
+               std::memory_order_relaxed)) {
+    }
+  }
+
+  [[nodiscard]] Snapshot snapshot() const {
+    Snapshot result;
+    for (std::size_t idx = 0; idx < NUM_BUCKETS; ++idx) {
+      result.counts[idx] = m_counts[idx].load(std::memory_order_relaxed);
+      result.count += result.counts[idx];
+    }
+    result.sum = m_sum.load(std::memory_order_relaxed);
+    result.max = m_max.load(std::memory_order_relaxed);
+    return result;
+  }
+};
+
+#endif // LATENCY_HISTOGRAM_H
@@ -0,0 +1,190 @@
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <array>
+#include <chrono>
+#include <fmt/core.h>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FacilityGame.h"
+#include "FacilityGameException.h"
+#include "LatencyHistogram.h"
+#include "enums.h"
+
+// the phase of a game, by the fraction of the nodes still free before a move:
+// more than 2/3, more than 1/3, or the rest
+enum class GamePhase { OPENING, MIDDLE, ENDGAME };
+
+constexpr std::array<std::string_view, 3> GAME_PHASE_NAMES{
+    "opening", "middle", "endgame"};
+
+inline GamePhase game_phase(std::size_t num_free, std::size_t num_nodes) {
+  if (3 * num_free > 2 * num_nodes) {
+    return GamePhase::OPENING;
+  }
+  if (3 * num_free > num_nodes) {
+    return GamePhase::MIDDLE;
+  }
+  return GamePhase::ENDGAME;
+}
+
+// the time one player took to initialize, and to choose its moves in every
+// phase, over any number of games
+struct PlayerLatency {
+  std::string name;
+  LatencyHistogram initialize;
+  std::array<LatencyHistogram, GAME_PHASE_NAMES.size()> moves;
+};
+
+// The think times of a set of players, e.g. the players of a tournament. The
+// histograms are lock-free, so the games of every thread record into the same
+// ones.
+class LatencyStats {
+private:
+  // the histograms hold atomics, which cannot move
+  std::vector<std::unique_ptr<PlayerLatency>> m_players;
+
+  // the rows of a report: the initialize times, every phase, and all the
+  // moves
+  template <typename Func>
+  static void for_each_row(PlayerLatency const &player, Func const &func) {
+    func(std::string_view("initialize"), player.initialize.snapshot());
+    LatencyHistogram::Snapshot all;
+    for (std::size_t phase = 0; phase < player.moves.size(); ++phase) {
+      auto const snapshot = player.moves[phase].snapshot();
+      func(GAME_PHASE_NAMES[phase], snapshot);
+      all += snapshot;
+    }
+    func(std::string_view("moves"), all);
+  }
+
+public:
+  explicit LatencyStats(std::vector<std::string> const &names) {
+    for (auto const &name : names) {
+      m_players.push_back(std::make_unique<PlayerLatency>());
+      m_players.back()->name = name;
+    }
+  }
+
+  [[nodiscard]] PlayerLatency &get(std::size_t idx) {
+    return *m_players[idx];
+  }
+
+  void print() const {
+    fmt::println(
+        "{:<12} {:<10} {:>9} {:>12} {:>12} {:>12}",
+        "PLAYER",
+        "PHASE",
+        "COUNT",
+        "P50 (us)",
+        "P99 (us)",
+        "MAX (us)");
+    for (auto const &player : m_players) {
+      for_each_row(
+          *player,
+          [&player](
+              std::string_view phase,
+              LatencyHistogram::Snapshot const &snapshot) {
+            fmt::println(
+                "{:<12} {:<10} {:>9} {:>12.1f} {:>12.1f} {:>12.1f}",
+                player->name,
+                phase,
+                snapshot.count,
+                static_cast<double>(snapshot.percentile(0.5)) / 1e3,
+                static_cast<double>(snapshot.percentile(0.99)) / 1e3,
+                static_cast<double>(snapshot.max) / 1e3);
+          });
+    }
+  }
+
+  // {"players": [{"name": ..., "initialize": {...}, "opening": {...},
+  // "middle": {...}, "endgame": {...}, "moves": {...}}, ...]}, with the
+  // count, p50_ns, p99_ns, max_ns and mean_ns of every row
+  [[nodiscard]] std::string to_json() const {
+    std::string json = "{\"players\": [";
+    for (std::size_t idx = 0; idx < m_players.size(); ++idx) {
+      json += idx == 0 ? "\n" : ",\n";
+      json += fmt::format("  {{\"name\": \"{}\"", m_players[idx]->name);
+      for_each_row(
+          *m_players[idx],
+          [&json](
+              std::string_view phase,
+              LatencyHistogram::Snapshot const &snapshot) {
+            json += fmt::format(
+                ",\n   \"{}\": {{\"count\": {}, \"p50_ns\": {}, "
+                "\"p99_ns\": {}, \"max_ns\": {}, \"mean_ns\": {:.1f}}}",
+                phase,
+                snapshot.count,
+                snapshot.percentile(0.5),
+                snapshot.percentile(0.99),
+                snapshot.max,
+                snapshot.mean());
+          });
+      json += "}";
+    }
+    json += "\n]}\n";
+    return json;
+  }
+
+  void save(std::string const &path) const {
+    std::ofstream out(path, std::ios::trunc);
+    out << to_json();
+    if (!out.flush()) {
+      throw FacilityGameException(
+          ("Cannot write latency report: " + path).c_str());
+    }
+  }
+};
+
+// A play_game observer which times the initialize and next_move calls of both
+// players into their histograms, if any, and keeps the times of the moves,
+// e.g. for a move log, if times is not null. It is made for a cleared game.
+class MoveTimer {
+private:
+  FacilityGame const &m_game;
+  std::array<PlayerLatency *, 2> m_latency;
+  std::vector<std::chrono::nanoseconds> *m_times;
+  // the free nodes before the next move, for its phase
+  std::size_t m_num_free;
+
+  [[nodiscard]] PlayerLatency *latency(Player player) const {
+    return m_latency[player == Player::PLAYER_A ? 0 : 1];
+  }
+
+public:
+  MoveTimer(
+      FacilityGame const &game,
+      PlayerLatency *latency_a,
+      PlayerLatency *latency_b,
+      std::vector<std::chrono::nanoseconds> *times)
+      : m_game(game),
+        m_latency{latency_a, latency_b},
+        m_times(times),
+        m_num_free(game.num_free()) {}
+
+  void initialized(Player player, std::chrono::nanoseconds time) const {
+    if (PlayerLatency *stats = latency(player)) {
+      stats->initialize.record(time);
+    }
+  }
+
+  void operator()(
+      Player player,
+      [[maybe_unused]] std::size_t move,
+      std::chrono::nanoseconds time) {
+    if (PlayerLatency *stats = latency(player)) {
+      auto const phase = game_phase(m_num_free, m_game.get_num_nodes());
+      stats->moves[static_cast<std::size_t>(phase)].record(time);
+    }
+    if (m_times != nullptr) {
+      m_times->push_back(time);
+    }
+    m_num_free = m_game.num_free();
+  }
+};
+
+#endif // LATENCY_STATS_H
@@ -0,0 +1,69 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <span>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "FacilityGameException.h"
+
+// A whole file mapped read-only into memory. The pages are shared through the
+// page cache by every process which maps the same file.
+class MappedFile {
+private:
+  void *m_data{};
+  std::size_t m_size{};
+
+public:
+  explicit MappedFile(std::string const &path) {
+    int const fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      fail(path, std::strerror(errno));
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      fail(path, std::strerror(errno));
+    }
+    m_size = static_cast<std::size_t>(info.st_size);
+    if (m_size > 0) {
+      m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (m_data == MAP_FAILED) {
+      m_data = nullptr;
+      fail(path, std::strerror(errno));
+    }
+  }
+
+  MappedFile(MappedFile const &) = delete;
+  MappedFile(MappedFile &&) = delete;
+  MappedFile &operator=(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile &&) = delete;
+
+  ~MappedFile() {
+    if (m_data != nullptr) {
+      ::munmap(m_data, m_size);
+    }
+  }
+
+  [[noreturn]] static void fail(std::string const &path, char const *reason) {
+    throw FacilityGameException(
+        ("Cannot open " + path + ": " + reason).c_str());
+  }
+
+  [[nodiscard]] std::span<unsigned char const> bytes() const {
+    return {static_cast<unsigned char const *>(m_data), m_size};
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_size;
+  }
+};
+
+#endif // MAPPED_FILE_H
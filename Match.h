@@ -0,0 +1,92 @@
+#ifndef MATCH_H
+#define MATCH_H
+
+#include <chrono>
+#include <concepts>
+
+#include "FPlayer.h"
+#include "FacilityGame.h"
+
+// anything which can play a game: FPlayer itself, for players selected at
+// runtime, or a concrete (final) player, so that the whole game loop is
+// specialized for it and its next_move can be inlined
+template <typename T>
+concept GamePlayer = requires(T &player, FacilityGame const &game) {
+  player.initialize(game);
+  { player.next_move(game) } -> std::convertible_to<std::size_t>;
+};
+
+// does nothing after a move, and the moves are not timed
+struct NoMoveObserver {
+  void operator()(
+      [[maybe_unused]] Player player,
+      [[maybe_unused]] std::size_t move,
+      [[maybe_unused]] std::chrono::nanoseconds time) const {}
+};
+
+// called after every move with its player, the move and the time the player
+// took to choose it; if it also has initialized(player, time), that is called
+// with the time each player took to initialize
+template <typename T>
+concept MoveObserver =
+    std::invocable<T &, Player, std::size_t, std::chrono::nanoseconds>;
+
+// plays a whole game on a cleared board, player_a moves first
+template <
+    GamePlayer PlayerA,
+    GamePlayer PlayerB,
+    MoveObserver Observer = NoMoveObserver>
+void play_game(
+    FacilityGame &game,
+    PlayerA &player_a,
+    PlayerB &player_b,
+    Observer on_move = {}) {
+  auto initialize = [&game, &on_move](Player player, auto &current) {
+    if constexpr (requires {
+                    on_move.initialized(player, std::chrono::nanoseconds{});
+                  }) {
+      auto const start = std::chrono::steady_clock::now();
+      current.initialize(game);
+      on_move.initialized(player, std::chrono::steady_clock::now() - start);
+    } else {
+      current.initialize(game);
+    }
+  };
+  initialize(Player::PLAYER_A, player_a);
+  initialize(Player::PLAYER_B, player_b);
+
+  auto play = [&game, &on_move](Player player, auto &current) {
+    if constexpr (std::same_as<Observer, NoMoveObserver>) {
+      game.append_move(player, current.next_move(game));
+    } else {
+      auto const start = std::chrono::steady_clock::now();
+      std::size_t const move = current.next_move(game);
+      auto const time = std::chrono::steady_clock::now() - start;
+      game.append_move(player, move);
+      on_move(player, move, time);
+    }
+  };
+  while (true) {
+    if (game.is_finished()) {
+      break;
+    }
+    play(Player::PLAYER_A, player_a);
+    if (game.is_finished()) {
+      break;
+    }
+    play(Player::PLAYER_B, player_b);
+  }
+}
+
+// plays a whole game between two players known at compile time, created with
+// their default settings
+template <GamePlayer PlayerA, GamePlayer PlayerB>
+  requires std::constructible_from<PlayerA, Player>
+           && std::constructible_from<PlayerB, Player>
+void play_match(FacilityGame &game) {
+  PlayerA player_a(Player::PLAYER_A);
+  PlayerB player_b(Player::PLAYER_B);
+  play_game(game, player_a, player_b);
+}
+
+#endif // MATCH_H
@@ -1,11 +1,19 @@
 #ifndef MONITOR_THREAD_H
 #define MONITOR_THREAD_H
 
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
 #include <fmt/core.h>
+#include <memory>
 #include <mutex>
+#include <stop_token>
 #include <thread>
+#include <utility>
+#include <vector>
 
+#include "FacilityGameException.h"
 #include "enums.h"
 
 constexpr auto INFO_MESSAGE_DUR = std::chrono::milliseconds(8000);
@@ -13,95 +21,200 @@ constexpr auto WARN_MESSAGE_DUR = std::chrono::milliseconds(10000);
 constexpr auto CHECK_DUR = std::chrono::milliseconds(500);
 constexpr auto WAIT_DUR = std::chrono::milliseconds(10000);
 
+// One thread which watches any number of games, up to a capacity fixed at
+// construction. Every game gets a slot, where its thread publishes the round
+// and the player state as a single atomic word, so the game thread never
+// takes a lock or waits; the monitor thread scans the slots every CHECK_DUR,
+// warns about the games whose state has not changed for WAIT_DUR, and prints
+// a summary every INFO_MESSAGE_DUR. Stopping wakes the monitor thread at
+// once.
 class MonitorThread {
 private:
   using clock_t = std::chrono::steady_clock;
   using time_point_t = std::chrono::time_point<clock_t>;
 
-  PlayerState m_player_state{PlayerState::UNINIT};
-  bool m_stop_received{};
-  int m_game_round{};
-  time_point_t m_last_change_time{};
-  time_point_t m_start_time{};
-  time_point_t m_last_info_time{};
-  time_point_t m_last_warn_time{};
-  mutable std::mutex m_mtx;
-
-  [[nodiscard]] PlayerState get_state() const {
-    std::scoped_lock sl(m_mtx);
-    return m_player_state;
+  // the round in the high 32 bits, the number of state changes in the next
+  // 24 and the state in the low 8, so that the monitor sees a change even if
+  // the state went back to the one it saw last
+  static constexpr unsigned CHANGES_SHIFT = 8;
+  static constexpr unsigned ROUND_SHIFT = 32;
+  static constexpr std::uint64_t STATE_MASK = (1U << CHANGES_SHIFT) - 1;
+  static constexpr std::uint64_t CHANGES_MASK =
+      ((std::uint64_t{1} << ROUND_SHIFT) - 1) & ~STATE_MASK;
+
+  struct Slot {
+    std::atomic<bool> in_use{};
+    // counts the games which used the slot, so that the monitor can tell
+    // them apart
+    std::atomic<std::uint64_t> generation{};
+    std::atomic<std::uint64_t> word{};
+    time_point_t start_time{};
+  };
+
+  // what the monitor thread knows of a slot, only used by it
+  struct Seen {
+    std::uint64_t generation{};
+    std::uint64_t word{};
+    time_point_t last_change_time{};
+    time_point_t last_warn_time{};
+  };
+
+  std::unique_ptr<Slot[]> m_slots;
+  std::size_t m_capacity;
+  std::mutex m_mtx;
+  std::condition_variable_any m_cv;
+  // started last, since it uses the members above
+  std::jthread m_thread;
+
+  static PlayerState state_of(std::uint64_t word) {
+    return static_cast<PlayerState>(word & STATE_MASK);
   }
 
-  [[nodiscard]] bool get_stop() const {
-    std::scoped_lock sl(m_mtx);
-    return m_stop_received;
+  static std::uint64_t round_of(std::uint64_t word) {
+    return word >> ROUND_SHIFT;
   }
 
-  void check_progress() {
-    std::scoped_lock sl(m_mtx);
-    auto current_time = clock_t::now();
-    auto dur_since_last_change = current_time - m_last_change_time;
-    auto dur_since_last_warn = current_time - m_last_warn_time;
+  void check_progress(
+      std::size_t idx,
+      Seen &seen,
+      time_point_t current_time) const {
+    Slot const &slot = m_slots[idx];
+    std::uint64_t const generation =
+        slot.generation.load(std::memory_order_acquire);
+    std::uint64_t const word = slot.word.load(std::memory_order_acquire);
+    // a new round alone is not progress, as before
+    if (generation != seen.generation
+        || (word & (STATE_MASK | CHANGES_MASK))
+               != (seen.word & (STATE_MASK | CHANGES_MASK))) {
+      seen.generation = generation;
+      seen.last_change_time = current_time;
+    }
+    seen.word = word;
 
+    auto dur_since_last_change = current_time - seen.last_change_time;
+    auto dur_since_last_warn = current_time - seen.last_warn_time;
     if (dur_since_last_change > WAIT_DUR
-        && dur_since_last_warn > WARN_MESSAGE_DUR) {
+        && dur_since_last_warn > WARN_MESSAGE_DUR
+        && state_of(word) != PlayerState::TERMINATING) {
       fmt::println(
-          "Monitor WARN: round:{}, player in state {} for {} sec",
-          m_game_round,
-          player_state_to_str(m_player_state),
+          "Monitor WARN: game:{}, round:{}, player in state {} for {} sec",
+          idx,
+          round_of(word),
+          player_state_to_str(state_of(word)),
           std::chrono::duration_cast<std::chrono::seconds>(
               dur_since_last_change)
               .count());
-      m_last_warn_time = current_time;
+      seen.last_warn_time = current_time;
     }
   }
 
-  void check_info() {
-    std::scoped_lock sl(m_mtx);
-    auto current_time = clock_t::now();
-    auto dur_since_last_info = current_time - m_last_info_time;
-    if (dur_since_last_info > INFO_MESSAGE_DUR) {
-      fmt::println("Monitor INFO: round:{}", m_game_round);
-      m_last_info_time = current_time;
+  void run(std::stop_token stop) {
+    std::vector<Seen> seen(m_capacity);
+    time_point_t last_info_time = clock_t::now();
+    while (!stop.stop_requested()) {
+      auto const current_time = clock_t::now();
+      std::size_t num_games{};
+      std::uint64_t num_rounds{};
+      for (std::size_t idx = 0; idx < m_capacity; ++idx) {
+        if (m_slots[idx].in_use.load(std::memory_order_acquire)) {
+          check_progress(idx, seen[idx], current_time);
+          ++num_games;
+          num_rounds += round_of(seen[idx].word);
+        }
+      }
+      if (current_time - last_info_time > INFO_MESSAGE_DUR) {
+        fmt::println(
+            "Monitor INFO: games:{}, rounds:{}",
+            num_games,
+            num_rounds);
+        last_info_time = current_time;
+      }
+
+      std::unique_lock lock(m_mtx);
+      m_cv.wait_for(lock, stop, CHECK_DUR, []() { return false; });
     }
   }
 
 public:
-  void set_state(int game_round, PlayerState player_state) {
-    std::scoped_lock sl(m_mtx);
-    m_game_round = game_round;
-    if (m_player_state != player_state) {
-      m_player_state = player_state;
-      m_last_change_time = clock_t::now();
+  // a game's slot, released when it is destroyed
+  class Game {
+  private:
+    Slot *m_slot;
+
+  public:
+    explicit Game(Slot *slot) : m_slot(slot) {}
+    Game(Game const &) = delete;
+    Game(Game &&other) noexcept : m_slot(std::exchange(other.m_slot, {})) {}
+    Game &operator=(Game const &) = delete;
+    Game &operator=(Game &&) = delete;
+
+    ~Game() {
+      if (m_slot != nullptr) {
+        m_slot->in_use.store(false, std::memory_order_release);
+      }
     }
-  }
 
-  void request_stop() {
-    std::scoped_lock sl(m_mtx);
-    m_stop_received = true;
-  }
+    // only called by the thread of the game
+    void set_state(int game_round, PlayerState player_state) const {
+      std::uint64_t const word = m_slot->word.load(std::memory_order_relaxed);
+      std::uint64_t changes = word & CHANGES_MASK;
+      if (state_of(word) != player_state) {
+        changes = (changes + (1U << CHANGES_SHIFT)) & CHANGES_MASK;
+      }
+      m_slot->word.store(
+          (static_cast<std::uint64_t>(static_cast<std::uint32_t>(game_round))
+           << ROUND_SHIFT)
+              | changes | static_cast<std::uint64_t>(player_state),
+          std::memory_order_release);
+    }
 
-  void log(char const *const message) const {
-    std::scoped_lock sl(m_mtx);
-    auto current_time = clock_t::now();
-    auto dur_since_start = current_time - m_start_time;
-    fmt::println(
-        "Monitor LOG: round:{}, gametime:{} sec, message:{}",
-        m_game_round,
-        std::chrono::duration_cast<std::chrono::seconds>(dur_since_start)
-            .count(),
-        message);
-  }
+    void log(char const *const message) const {
+      std::uint64_t const word = m_slot->word.load(std::memory_order_relaxed);
+      fmt::println(
+          "Monitor LOG: round:{}, gametime:{} sec, message:{}",
+          round_of(word),
+          std::chrono::duration_cast<std::chrono::seconds>(
+              clock_t::now() - m_slot->start_time)
+              .count(),
+          message);
+    }
+  };
+
+  explicit MonitorThread(std::size_t capacity)
+      : m_slots(std::make_unique<Slot[]>(capacity)),
+        m_capacity(capacity),
+        m_thread([this](std::stop_token stop) { run(std::move(stop)); }) {}
 
-  void run() {
-    m_start_time = clock_t::now();
-    m_last_info_time = m_start_time;
-    m_last_warn_time = m_start_time;
-    while (!get_stop() && get_state() != PlayerState::TERMINATING) {
-      check_progress();
-      check_info();
-      std::this_thread::sleep_for(CHECK_DUR);
+  MonitorThread(MonitorThread const &) = delete;
+  MonitorThread(MonitorThread &&) = delete;
+  MonitorThread &operator=(MonitorThread const &) = delete;
+  MonitorThread &operator=(MonitorThread &&) = delete;
+
+  // the jthread asks the monitor thread to stop, which wakes it up, and
+  // joins it
+  ~MonitorThread() = default;
+
+  // a free slot for a new game, which starts UNINIT in round 0
+  [[nodiscard]] Game watch() {
+    for (std::size_t idx = 0; idx < m_capacity; ++idx) {
+      Slot &slot = m_slots[idx];
+      bool expected = false;
+      if (!slot.in_use.load(std::memory_order_relaxed)
+          && slot.in_use.compare_exchange_strong(
+              expected,
+              true,
+              std::memory_order_acquire)) {
+        slot.start_time = clock_t::now();
+        slot.word.store(0, std::memory_order_relaxed);
+        slot.generation.fetch_add(1, std::memory_order_release);
+        return Game(&slot);
+      }
     }
+    throw FacilityGameException("The monitor has no free slot");
+  }
+
+  void request_stop() {
+    m_thread.request_stop();
   }
 };
 
@@ -0,0 +1,206 @@
+#ifndef MOVE_LOG_H
+#define MOVE_LOG_H
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FacilityGame.h"
+#include "FacilityGameException.h"
+#include "MappedFile.h"
+
+// The move log format, an append-only sequence of games after a magic:
+//   MAGIC
+//   one record per game: the varint byte length of the rest of the record,
+//   then the varints size, seed and flags, the names of the two players as a
+//   varint length and the bytes, the varint number of moves, the moves, and
+//   if the TIMES flag is set, the time of every move in nanoseconds
+// A move is stored as the zigzag varint of its difference from the move
+// before it, so nearby moves take one byte. The byte lengths let a reader
+// find the records without decoding them, e.g. to split a log across threads.
+namespace move_log {
+
+constexpr std::array<unsigned char, 8> MAGIC{
+    'F', 'A', 'C', 'M', 'O', 'V', 'E', '1'};
+// the record has the times of the moves
+constexpr std::uint64_t TIMES = 1;
+
+inline void put_varint(std::vector<unsigned char> &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<unsigned char>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<unsigned char>(value));
+}
+
+inline void put_string(std::vector<unsigned char> &out, std::string_view text) {
+  put_varint(out, text.size());
+  out.insert(out.end(), text.begin(), text.end());
+}
+
+// reads the fields of one record, or of the whole log, from a byte range
+class Decoder {
+private:
+  unsigned char const *m_pos;
+  unsigned char const *m_end;
+
+  [[noreturn]] static void truncated() {
+    throw FacilityGameException("Truncated move log");
+  }
+
+public:
+  explicit Decoder(std::span<unsigned char const> bytes)
+      : m_pos(bytes.data()),
+        m_end(bytes.data() + bytes.size()) {}
+
+  [[nodiscard]] bool empty() const {
+    return m_pos == m_end;
+  }
+
+  [[nodiscard]] std::uint64_t varint() {
+    std::uint64_t value{};
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (m_pos == m_end) {
+        truncated();
+      }
+      unsigned char const byte = *m_pos++;
+      value |= std::uint64_t{byte & 0x7FU} << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+    throw FacilityGameException("Invalid varint in move log");
+  }
+
+  [[nodiscard]] std::span<unsigned char const> bytes(std::size_t count) {
+    if (static_cast<std::size_t>(m_end - m_pos) < count) {
+      truncated();
+    }
+    std::span<unsigned char const> const result(m_pos, count);
+    m_pos += count;
+    return result;
+  }
+
+  [[nodiscard]] std::string_view string() {
+    auto const text = bytes(varint());
+    return {reinterpret_cast<char const *>(text.data()), text.size()};
+  }
+};
+
+} // namespace move_log
+
+// one game of a move log; the times are empty if they were not recorded
+struct GameRecord {
+  std::size_t size{};
+  std::size_t seed{};
+  std::string player_a{};
+  std::string player_b{};
+  std::vector<std::size_t> moves{};
+  std::vector<std::chrono::nanoseconds> times{};
+
+  // appends the record, with its byte length, to out
+  void encode(std::vector<unsigned char> &out) const {
+    std::vector<unsigned char> body;
+    body.reserve(16 + player_a.size() + player_b.size() + 4 * moves.size());
+    move_log::put_varint(body, size);
+    move_log::put_varint(body, seed);
+    move_log::put_varint(body, times.empty() ? 0 : move_log::TIMES);
+    move_log::put_string(body, player_a);
+    move_log::put_string(body, player_b);
+    move_log::put_varint(body, moves.size());
+    std::uint64_t prev{};
+    for (std::uint64_t move : moves) {
+      std::uint64_t const delta = move - prev;
+      // zigzag, so that small negative differences are small too
+      move_log::put_varint(
+          body,
+          (delta << 1) ^ (std::uint64_t{0} - (delta >> 63)));
+      prev = move;
+    }
+    for (auto const time : times) {
+      move_log::put_varint(body, static_cast<std::uint64_t>(time.count()));
+    }
+    move_log::put_varint(out, body.size());
+    out.insert(out.end(), body.begin(), body.end());
+  }
+
+  // reads a record without its byte length; the vectors keep their capacity,
+  // so decoding many records into the same one does not allocate
+  void decode(std::span<unsigned char const> bytes) {
+    move_log::Decoder in(bytes);
+    size = in.varint();
+    seed = in.varint();
+    std::uint64_t const flags = in.varint();
+    player_a = in.string();
+    player_b = in.string();
+    std::uint64_t const num_moves = in.varint();
+    if (num_moves > bytes.size()) {
+      throw FacilityGameException("Invalid number of moves in move log");
+    }
+    moves.resize(num_moves);
+    std::uint64_t prev{};
+    for (auto &move : moves) {
+      std::uint64_t const zigzag = in.varint();
+      prev += (zigzag >> 1) ^ (std::uint64_t{0} - (zigzag & 1));
+      move = prev;
+    }
+    times.resize((flags & move_log::TIMES) != 0 ? num_moves : 0);
+    for (auto &time : times) {
+      time = std::chrono::nanoseconds(in.varint());
+    }
+    if (!in.empty()) {
+      throw FacilityGameException("Invalid record length in move log");
+    }
+  }
+
+  // plays the moves on game, which must be the cleared board of the record
+  void replay(FacilityGame &game) const {
+    for (std::size_t move : moves) {
+      if (move >= game.get_num_nodes()
+          || !game.append_move(game.get_player_to_move(), move)) {
+        throw FacilityGameException("Invalid move in move log");
+      }
+    }
+  }
+};
+
+// A move log mapped read-only into memory, with the byte range of every
+// record found up front.
+class MoveLogReader {
+private:
+  MappedFile m_file;
+  std::vector<std::span<unsigned char const>> m_records;
+
+public:
+  explicit MoveLogReader(std::string const &path) : m_file(path) {
+    auto const bytes = m_file.bytes();
+    if (!std::ranges::equal(
+            bytes.first(std::min(bytes.size(), move_log::MAGIC.size())),
+            move_log::MAGIC)) {
+      MappedFile::fail("move log " + path, "not a move log");
+    }
+    move_log::Decoder in(bytes.subspan(move_log::MAGIC.size()));
+    while (!in.empty()) {
+      m_records.push_back(in.bytes(in.varint()));
+    }
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_records.size();
+  }
+
+  [[nodiscard]] std::size_t num_bytes() const {
+    return m_file.size();
+  }
+
+  void read(std::size_t idx, GameRecord &record) const {
+    record.decode(m_records[idx]);
+  }
+};
+
+#endif // MOVE_LOG_H
@@ -0,0 +1,134 @@
+#ifndef MOVE_LOG_WRITER_H
+#define MOVE_LOG_WRITER_H
+
+#include <algorithm>
+#include <array>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FacilityGameException.h"
+#include "MoveLog.h"
+
+// Appends games to a move log. The games are encoded on the thread which
+// records them and copied to a buffer, and a background thread writes the
+// buffer to the file whenever it holds FLUSH_BYTES, so recording a game never
+// waits for the disk; any number of threads can record at once. A write
+// error is reported by close().
+class MoveLogWriter {
+private:
+  static constexpr std::size_t FLUSH_BYTES = 1 << 16;
+
+  std::string m_path;
+  std::FILE *m_file{};
+  std::mutex m_mtx;
+  std::condition_variable m_cv;
+  std::vector<unsigned char> m_pending;
+  bool m_stop{};
+  bool m_failed{};
+  // started last, since it uses the members above
+  std::jthread m_thread;
+
+  [[noreturn]] void fail(char const *reason) const {
+    throw FacilityGameException(
+        ("Cannot write move log " + m_path + ": " + reason).c_str());
+  }
+
+  void work() {
+    std::vector<unsigned char> buffer;
+    while (true) {
+      bool stop{};
+      {
+        std::unique_lock lock(m_mtx);
+        m_cv.wait(lock, [this]() {
+          return m_stop || m_pending.size() >= FLUSH_BYTES;
+        });
+        buffer.swap(m_pending);
+        stop = m_stop;
+      }
+      bool const written =
+          std::fwrite(buffer.data(), 1, buffer.size(), m_file) == buffer.size()
+          && (!stop || std::fflush(m_file) == 0);
+      buffer.clear();
+      if (!written) {
+        std::scoped_lock sl(m_mtx);
+        m_failed = true;
+      }
+      if (stop) {
+        return;
+      }
+    }
+  }
+
+  // writes what is left and waits for the writer; true if nothing failed
+  bool stop() {
+    if (m_file == nullptr) {
+      return true;
+    }
+    {
+      std::scoped_lock sl(m_mtx);
+      m_stop = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+    bool const closed = std::fclose(m_file) == 0;
+    m_file = nullptr;
+    return closed && !m_failed;
+  }
+
+public:
+  // appends to the log at path, which is created if it does not exist
+  explicit MoveLogWriter(std::string path) : m_path(std::move(path)) {
+    m_file = std::fopen(m_path.c_str(), "a+b");
+    if (m_file == nullptr) {
+      fail("cannot open it");
+    }
+    std::array<unsigned char, move_log::MAGIC.size()> magic{};
+    std::size_t const read = std::fread(magic.data(), 1, magic.size(), m_file);
+    if (read == 0) {
+      m_pending.assign(move_log::MAGIC.begin(), move_log::MAGIC.end());
+    } else if (magic != move_log::MAGIC) {
+      std::fclose(m_file);
+      m_file = nullptr;
+      fail("not a move log");
+    }
+    // a write after a read needs a seek in between
+    std::fseek(m_file, 0, SEEK_END);
+    m_thread = std::jthread([this]() { work(); });
+  }
+
+  MoveLogWriter(MoveLogWriter const &) = delete;
+  MoveLogWriter(MoveLogWriter &&) = delete;
+  MoveLogWriter &operator=(MoveLogWriter const &) = delete;
+  MoveLogWriter &operator=(MoveLogWriter &&) = delete;
+
+  ~MoveLogWriter() {
+    (void)stop();
+  }
+
+  void record(GameRecord const &record) {
+    std::vector<unsigned char> encoded;
+    record.encode(encoded);
+    bool full{};
+    {
+      std::scoped_lock sl(m_mtx);
+      m_pending.insert(m_pending.end(), encoded.begin(), encoded.end());
+      full = m_pending.size() >= FLUSH_BYTES;
+    }
+    if (full) {
+      m_cv.notify_one();
+    }
+  }
+
+  // writes the games recorded so far and closes the log
+  void close() {
+    if (!stop()) {
+      fail("write failed");
+    }
+  }
+};
+
+#endif // MOVE_LOG_WRITER_H
@@ -5,126 +5,135 @@
 #include <array>
 #include <cmath>
 #include <fmt/ranges.h>
+#include <iterator>
+#include <map>
+#include <set>
 
 #include "FPlayer.h"
+#include "TripletIndex.h"
 
 struct Move {
   std::size_t index;
   std::size_t value;
 };
 
-class NightHawk : public FPlayer {
+class NightHawk final : public FPlayer {
   static constexpr char const *PLAYER_NAME = "NightHawk";
   static constexpr char const *VERSION = "1.0";
   static constexpr char const *FIRSTNAME = "Christos";
   static constexpr char const *LASTNAME = "Gkantidis";
 
 private:
+  // a maximal run of one player's moves, at most 3 apart, with the best
+  // move extending it at its edges, and the best move joining it with the
+  // next cluster, if that one starts 4 to 6 nodes after it
+  struct Cluster {
+    std::size_t last;
+    std::size_t size;
+    Move edge;
+    Move middle;
+  };
+
+  // the non-zero edge or middle moves of the clusters, keyed by their value
+  // and the first node of their cluster; the first one is the best, and the
+  // leftmost on ties
+  struct RankOrder {
+    bool operator()(
+        std::pair<std::size_t, std::size_t> const &lhs,
+        std::pair<std::size_t, std::size_t> const &rhs) const {
+      return lhs.first > rhs.first
+             || (lhs.first == rhs.first && lhs.second < rhs.second);
+    }
+  };
+  using RankedMoves = std::set<std::pair<std::size_t, std::size_t>, RankOrder>;
+
+  // the moves of one player as clusters, keyed by their first node
+  struct MoveSet {
+    std::map<std::size_t, Cluster> clusters;
+    RankedMoves edges;
+    RankedMoves middles;
+    std::size_t size{};
+  };
+  using ClusterIt = std::map<std::size_t, Cluster>::iterator;
+
   std::size_t m_num_nodes{};
-  std::vector<std::size_t> m_nodes;
-  std::vector<std::size_t> m_my_moves;
-  std::vector<std::size_t> m_vs_moves;
+  MoveSet m_my_moves;
+  MoveSet m_vs_moves;
+  // the number of moves of the game the clusters have been updated with
+  std::size_t m_num_moves{};
   std::vector<Move> m_followup_moves;
+  // the best triplet to start, updated with the moves of both players
+  TripletIndex m_triplets;
 
 public:
   explicit NightHawk(Player player)
       : FPlayer(player, PLAYER_NAME, VERSION, FIRSTNAME, LASTNAME) {}
 
+  // the game may have moves already, e.g. from an opening book; they are
+  // added to the clusters, except for the last move of the opponent, which
+  // next_move adds, and the clusters are refreshed by the next sync
   void initialize(FacilityGame const &game) override {
     m_num_nodes = game.get_num_nodes();
-    m_nodes = game.get_nodes();
+    m_my_moves = {};
+    m_vs_moves = {};
+    m_followup_moves.clear();
+    auto const &moves = game.get_moves();
+    std::size_t const num_added =
+        game.get_player_to_move() == m_player && !moves.empty()
+            ? moves.size() - 1
+            : moves.size();
+    for (std::size_t idx = 0; idx < num_added; ++idx) {
+      Player const player =
+          idx % 2 == 0 ? Player::PLAYER_A : Player::PLAYER_B;
+      add_move(game, moves[idx], player == m_player ? m_my_moves : m_vs_moves);
+    }
+    m_num_moves = 0;
+    m_triplets.assign(game);
   }
 
 private:
   Move start_best_possible_triplet(FacilityGame const &game) {
-    std::size_t max_sum{};
-    std::size_t a{};
-    std::size_t b{};
-    std::size_t c{};
-
-    for (std::size_t i = 0; i < m_nodes.size() - 4; i++) {
-      if (game.get_status(i) == FacilityStatus::FREE
-          && game.get_status(i + 2) == FacilityStatus::FREE
-          && game.get_status(i + 4) == FacilityStatus::FREE) {
-        std::size_t sum = m_nodes[i] + m_nodes[i + 2] + m_nodes[i + 4];
-        if (sum > max_sum) {
-          max_sum = sum;
-          a = i;
-          b = i + 2;
-          c = i + 4;
-        }
-      }
-    }
-
-    for (std::size_t i = 0; i < m_nodes.size() - 5; i++) {
-      if (game.get_status(i) == FacilityStatus::FREE
-          && game.get_status(i + 2) == FacilityStatus::FREE
-          && game.get_status(i + 5) == FacilityStatus::FREE) {
-        std::size_t sum = m_nodes[i] + m_nodes[i + 2] + m_nodes[i + 5];
-        if (sum > max_sum) {
-          max_sum = sum;
-          a = i;
-          b = i + 2;
-          c = i + 5;
-        }
-      }
+    m_triplets.update(game);
+    auto const triplet = m_triplets.best(game);
+    if (!triplet) {
+      return {0, 0};
     }
-
-    for (std::size_t i = 0; i < m_nodes.size() - 5; i++) {
-      if (game.get_status(i) == FacilityStatus::FREE
-          && game.get_status(i + 3) == FacilityStatus::FREE
-          && game.get_status(i + 5) == FacilityStatus::FREE) {
-        std::size_t sum = m_nodes[i] + m_nodes[i + 3] + m_nodes[i + 5];
-        if (sum > max_sum) {
-          max_sum = sum;
-          a = i;
-          b = i + 3;
-          c = i + 5;
-        }
-      }
-    }
-
-    for (std::size_t i = 0; i < m_nodes.size() - 6; i++) {
-      if (game.get_status(i) == FacilityStatus::FREE
-          && game.get_status(i + 3) == FacilityStatus::FREE
-          && game.get_status(i + 6) == FacilityStatus::FREE) {
-        std::size_t sum = m_nodes[i] + m_nodes[i + 3] + m_nodes[i + 6];
-        if (sum > max_sum) {
-          max_sum = sum;
-          a = i;
-          b = i + 3;
-          c = i + 6;
-        }
-      }
+    std::size_t const max_sum = triplet->sum;
+    auto const [a, b, c] = triplet->nodes;
+
+    std::array<Move, 3> abc{};
+    abc[0] = {a, game.get_node(a)};
+    abc[1] = {b, game.get_node(b)};
+    abc[2] = {c, game.get_node(c)};
+    std::sort(abc.begin(), abc.end(), [](Move const &lhs, Move const &rhs) {
+      return lhs.value > rhs.value;
+    });
+
+    auto expected_value =
+        static_cast<std::size_t>(std::round(2.5 * (double)max_sum));
+    if (abc[0].index == a) {
+      m_followup_moves.emplace_back(a, expected_value);
+      m_followup_moves.emplace_back(b, expected_value);
+      m_followup_moves.emplace_back(c, expected_value);
+    } else if (abc[0].index == c) {
+      m_followup_moves.emplace_back(c, expected_value);
+      m_followup_moves.emplace_back(b, expected_value);
+      m_followup_moves.emplace_back(a, expected_value);
+    } else {
+      m_followup_moves.emplace_back(abc[0].index, expected_value);
+      m_followup_moves.emplace_back(abc[1].index, expected_value);
+      m_followup_moves.emplace_back(abc[2].index, expected_value);
     }
+    return abc[0];
+  }
 
-    if (max_sum > 0) {
-      std::array<Move, 3> abc{};
-      abc[0] = {a, m_nodes[a]};
-      abc[1] = {b, m_nodes[b]};
-      abc[2] = {c, m_nodes[c]};
-      std::sort(abc.begin(), abc.end(), [](Move const &lhs, Move const &rhs) {
-        return lhs.value > rhs.value;
-      });
-
-      auto expected_value =
-          static_cast<std::size_t>(std::round(2.5 * (double)max_sum));
-      if (abc[0].index == a) {
-        m_followup_moves.emplace_back(a, expected_value);
-        m_followup_moves.emplace_back(b, expected_value);
-        m_followup_moves.emplace_back(c, expected_value);
-      } else if (abc[0].index == c) {
-        m_followup_moves.emplace_back(c, expected_value);
-        m_followup_moves.emplace_back(b, expected_value);
-        m_followup_moves.emplace_back(a, expected_value);
-      } else {
-        m_followup_moves.emplace_back(abc[0].index, expected_value);
-        m_followup_moves.emplace_back(abc[1].index, expected_value);
-        m_followup_moves.emplace_back(abc[2].index, expected_value);
-      }
-      return abc[0];
-    }
-    return {0, 0};
+  // the points of a bonus group of three nodes
+  static std::size_t triplet_points(
+      FacilityGame const &game,
+      std::size_t a,
+      std::size_t b,
+      std::size_t c) {
+    return 3 * (game.get_node(a) + game.get_node(b) + game.get_node(c));
   }
 
   Move compute_points_for_edges(
@@ -134,17 +143,16 @@ private:
       std::size_t continuous) {
     using FacilityStatus::FREE;
     Move to_rtn{0, 0};
-    auto const &nodes = game.get_nodes();
-    std::size_t const n = nodes.size();
+    std::size_t const n = game.get_num_nodes();
 
     // checks if it can make or increment a triplet by adding to the left
     // of the left-most node
     if (first >= 2 && game.get_status(first - 2) == FREE) {
       std::size_t points{};
       if (continuous == 2) {
-        points = 3 * (nodes[first - 2] + nodes[first] + nodes[last]);
+        points = triplet_points(game, first - 2, first, last);
       } else {
-        points = 3 * nodes[first - 2];
+        points = 3 * game.get_node(first - 2);
       }
       if (points > to_rtn.value) {
         to_rtn = {first - 2, points};
@@ -153,9 +161,9 @@ private:
     if (first >= 3 && game.get_status(first - 3) == FREE) {
       std::size_t points{};
       if (continuous == 2) {
-        points = 3 * (nodes[first - 3] + nodes[first] + nodes[last]);
+        points = triplet_points(game, first - 3, first, last);
       } else {
-        points = 3 * nodes[first - 3];
+        points = 3 * game.get_node(first - 3);
       }
       if (points > to_rtn.value) {
         to_rtn = {first - 3, points};
@@ -166,9 +174,9 @@ private:
     if (last <= n - 3 && game.get_status(last + 2) == FREE) {
       std::size_t points{};
       if (continuous == 2) {
-        points = 3 * (nodes[first] + nodes[last] + nodes[last + 2]);
+        points = triplet_points(game, first, last, last + 2);
       } else {
-        points = 3 * nodes[last + 2];
+        points = 3 * game.get_node(last + 2);
       }
       if (points > to_rtn.value) {
         to_rtn = {last + 2, points};
@@ -177,9 +185,9 @@ private:
     if (last <= n - 4 && game.get_status(last + 3) == FREE) {
       std::size_t points{};
       if (continuous == 2) {
-        points = 3 * (nodes[first] + nodes[last] + nodes[last + 3]);
+        points = triplet_points(game, first, last, last + 3);
       } else {
-        points = 3 * nodes[last + 3];
+        points = 3 * game.get_node(last + 3);
       }
       if (points > to_rtn.value) {
         to_rtn = {last + 3, points};
@@ -188,39 +196,11 @@ private:
     return to_rtn;
   }
 
-  Move inc_best_triplet_by_edges(
-      FacilityGame const &game,
-      std::vector<std::size_t> const &moves) {
-    std::size_t i = 1;
-    std::size_t first = moves[0];
-    std::size_t continuous = 1;
-    Move to_rtn{0, 0};
-
-    while (i < moves.size()) {
-      if (moves[i] - moves[i - 1] <= 3) {
-        continuous++;
-      } else {
-        if (continuous >= 2) {
-          Move tmp_move =
-              compute_points_for_edges(game, first, moves[i - 1], continuous);
-          if (tmp_move.value > to_rtn.value) {
-            to_rtn = tmp_move;
-          }
-        }
-        first = moves[i];
-        continuous = 1;
-      }
-      i++;
+  static Move inc_best_triplet_by_edges(MoveSet const &moves) {
+    if (moves.edges.empty()) {
+      return {0, 0};
     }
-    if (continuous >= 2) {
-      Move tmp_move =
-          compute_points_for_edges(game, first, moves[i - 1], continuous);
-      if (tmp_move.value > to_rtn.value) {
-        to_rtn = tmp_move;
-      }
-    }
-
-    return to_rtn;
+    return moves.clusters.at(moves.edges.begin()->second).edge;
   }
 
   static Move compute_points_for_middle(
@@ -229,13 +209,12 @@ private:
       std::size_t last) {
     using FacilityStatus::FREE;
     Move to_rtn{0, 0};
-    auto const &nodes = game.get_nodes();
 
     // if there is one free node between the two teams I can select only the
     // middle one
     if (last - first == 4 && game.get_status(first + 2) == FREE) {
       auto move = first + 2;
-      to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+      to_rtn = {move, triplet_points(game, first, move, last)};
     }
     // if there are two FREE nodes between the two teams I can create a new
     // bigger team by selecting anyone of them, so I select the one with the
@@ -244,21 +223,21 @@ private:
       // if both FREE, select the one with the highest value
       if (game.get_status(first + 2) == FREE
           && game.get_status(first + 3) == FREE) {
-        if (nodes[first + 2] > nodes[first + 3]) {
+        if (game.get_node(first + 2) > game.get_node(first + 3)) {
           auto move = first + 2;
-          to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+          to_rtn = {move, triplet_points(game, first, move, last)};
         } else {
           auto move = first + 3;
-          to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+          to_rtn = {move, triplet_points(game, first, move, last)};
         }
       }
       // else select the one who is FREE (if any)
       else if (game.get_status(first + 2) == FREE) {
         auto move = first + 2;
-        to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+        to_rtn = {move, triplet_points(game, first, move, last)};
       } else if (game.get_status(first + 3) == FREE) {
         auto move = first + 3;
-        to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+        to_rtn = {move, triplet_points(game, first, move, last)};
       }
     }
     // if there are three FREE nodes between the two teams, I can either
@@ -271,22 +250,22 @@ private:
       if (game.get_status(first + 2) == FREE
           && game.get_status(first + 4) == FREE) {
         std::size_t max_points{};
-        if (nodes[first + 2] > nodes[first + 4]) {
+        if (game.get_node(first + 2) > game.get_node(first + 4)) {
           auto move = first + 2;
-          to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+          to_rtn = {move, triplet_points(game, first, move, last)};
         } else {
           auto move = first + 4;
-          to_rtn = {move, 3 * (nodes[first] + nodes[move] + nodes[last])};
+          to_rtn = {move, triplet_points(game, first, move, last)};
         }
 
         to_rtn.value = static_cast<std::size_t>(std::floor(
             0.8
-            * (2 * nodes[first] + 3 * nodes[first + 2] + 3 * nodes[first + 4]
-               + 2 * nodes[last])));
+            * (2 * game.get_node(first) + 3 * game.get_node(first + 2)
+               + 3 * game.get_node(first + 4) + 2 * game.get_node(last))));
       }
       if (game.get_status(first + 3) == FREE) {
         std::size_t tmp_points =
-            3 * (nodes[first] + nodes[first + 3] + nodes[last]);
+            triplet_points(game, first, first + 3, last);
         if (tmp_points > to_rtn.value) {
           to_rtn = {first + 3, tmp_points};
         }
@@ -295,50 +274,123 @@ private:
     return to_rtn;
   }
 
-  static Move inc_best_triplet_by_middle(
-      FacilityGame const &game,
-      std::vector<std::size_t> const &moves) {
-    std::size_t i = 1;
-    std::size_t first{};
-    std::size_t last{};
-    Move move{0, 0};
-
-    while (i < moves.size()) {
-      std::size_t space = moves[i] - moves[i - 1];
+  static Move inc_best_triplet_by_middle(MoveSet const &moves) {
+    if (moves.middles.empty()) {
+      return {0, 0};
+    }
+    return moves.clusters.at(moves.middles.begin()->second).middle;
+  }
+
+  static Move find_best_node(FacilityGame const &game) {
+    if (auto const idx = game.highest_free()) {
+      return {*idx, game.get_node(*idx)};
+    }
+    return {0, 0};
+  }
+
+  static void set_move(
+      RankedMoves &ranked,
+      std::size_t first,
+      Move &current,
+      Move move) {
+    if (current.value > 0) {
+      ranked.erase({current.value, first});
+    }
+    current = move;
+    if (current.value > 0) {
+      ranked.emplace(current.value, first);
+    }
+  }
+
+  // recomputes the edge move of a cluster and the middle moves to its
+  // neighbors from the current statuses
+  void refresh(FacilityGame const &game, MoveSet &moves, ClusterIt it) {
+    auto &[first, cluster] = *it;
+    set_move(
+        moves.edges,
+        first,
+        cluster.edge,
+        cluster.size >= 2
+            ? compute_points_for_edges(game, first, cluster.last, cluster.size)
+            : Move{0, 0});
+
+    auto middle = [&game](ClusterIt left, ClusterIt right) {
+      std::size_t const space = right->first - left->second.last;
       if (space >= 4 && space <= 6) {
-        first = moves[i - 1];
-        last = moves[i];
-        auto tmp_move = compute_points_for_middle(game, first, last);
-        if (tmp_move.value > move.value) {
-          move = tmp_move;
-        }
+        return compute_points_for_middle(game, left->second.last, right->first);
       }
-      i++;
+      return Move{0, 0};
+    };
+    if (it != moves.clusters.begin()) {
+      auto const prev = std::prev(it);
+      set_move(
+          moves.middles,
+          prev->first,
+          prev->second.middle,
+          middle(prev, it));
     }
+    auto const next = std::next(it);
+    set_move(
+        moves.middles,
+        first,
+        cluster.middle,
+        next != moves.clusters.end() ? middle(it, next) : Move{0, 0});
+  }
 
-    return move;
+  void erase_cluster(MoveSet &moves, ClusterIt it) {
+    set_move(moves.edges, it->first, it->second.edge, {0, 0});
+    set_move(moves.middles, it->first, it->second.middle, {0, 0});
+    moves.clusters.erase(it);
   }
 
-  static Move find_best_node(FacilityGame const &game) {
-    std::size_t best_idx{};
-    std::size_t best_value{};
-
-    static constexpr auto free = FacilityStatus::FREE;
-    auto const &nodes = game.get_nodes();
-    auto const &statuses = game.get_statuses();
-    for (std::size_t idx = 0; idx < nodes.size(); ++idx) {
-      if (statuses[idx] == free && nodes[idx] > best_value) {
-        best_idx = idx;
-        best_value = nodes[idx];
+  // adds a move, joining the clusters at most 3 nodes away from it
+  void add_move(FacilityGame const &game, std::size_t move, MoveSet &moves) {
+    std::size_t first = move;
+    Cluster joined{move, 1, {0, 0}, {0, 0}};
+
+    auto next = moves.clusters.upper_bound(move);
+    if (next != moves.clusters.begin()) {
+      auto const prev = std::prev(next);
+      if (prev->second.last + 3 >= move) {
+        first = prev->first;
+        joined.last = std::max(prev->second.last, move);
+        joined.size += prev->second.size;
+        erase_cluster(moves, prev);
       }
     }
+    if (next != moves.clusters.end() && next->first - move <= 3) {
+      joined.last = std::max(joined.last, next->second.last);
+      joined.size += next->second.size;
+      erase_cluster(moves, next);
+    }
 
-    return {best_idx, best_value};
+    ++moves.size;
+    refresh(game, moves, moves.clusters.emplace(first, joined).first);
   }
 
-  static void add_move(std::size_t move, std::vector<std::size_t> &moves) {
-    auto it = std::lower_bound(moves.begin(), moves.end(), move);
-    moves.insert(it, move);
+  // a move changes the statuses of its node and its neighbors, which are
+  // only seen by the clusters at most 4 nodes away from it
+  void refresh_near(
+      FacilityGame const &game,
+      MoveSet &moves,
+      std::size_t move) {
+    auto it = moves.clusters.upper_bound(move + 4);
+    while (it != moves.clusters.begin()) {
+      --it;
+      if (it->second.last + 4 < move) {
+        break;
+      }
+      refresh(game, moves, it);
+    }
+  }
+
+  // refreshes the clusters near the moves played since the last call
+  void sync(FacilityGame const &game) {
+    auto const &moves = game.get_moves();
+    for (; m_num_moves < moves.size(); ++m_num_moves) {
+      refresh_near(game, m_my_moves, moves[m_num_moves]);
+      refresh_near(game, m_vs_moves, moves[m_num_moves]);
+    }
   }
 
 public:
@@ -346,8 +398,9 @@ public:
     if (std::vector<std::size_t> const &moves = game.get_moves();
         !moves.empty()) {
       std::size_t vs_move = moves.back();
-      add_move(vs_move, m_vs_moves);
+      add_move(game, vs_move, m_vs_moves);
     }
+    sync(game);
 
     Move my_move{0, 0};
 
@@ -387,13 +440,13 @@ public:
     // triplets, so search if there is a triplet to be made, and if the
     // points it gives are higher that those of the current move, change my
     // move
-    if (m_my_moves.size() >= 2) {
-      auto tmp_move = inc_best_triplet_by_edges(game, m_my_moves);
+    if (m_my_moves.size >= 2) {
+      auto tmp_move = inc_best_triplet_by_edges(m_my_moves);
       if (tmp_move.value > my_move.value) {
         my_move = tmp_move;
       }
 
-      tmp_move = inc_best_triplet_by_middle(game, m_my_moves);
+      tmp_move = inc_best_triplet_by_middle(m_my_moves);
       if (tmp_move.value > my_move.value) {
         my_move = tmp_move;
       }
@@ -413,8 +466,8 @@ public:
     // now make triplets, so search if there is a triplet to be made, and if
     // the points it gives are higher that those of the current move, change
     // my move to block his move
-    if (m_vs_moves.size() >= 2) {
-      auto tmp_move = inc_best_triplet_by_edges(game, m_vs_moves);
+    if (m_vs_moves.size >= 2) {
+      auto tmp_move = inc_best_triplet_by_edges(m_vs_moves);
       if (tmp_move.value > 0) {
         if (2.5 * tmp_move.value / 3 > my_move.value) {
           my_move = {
@@ -423,7 +476,7 @@ public:
         }
       }
 
-      tmp_move = inc_best_triplet_by_middle(game, m_vs_moves);
+      tmp_move = inc_best_triplet_by_middle(m_vs_moves);
       if (tmp_move.value != 0) {
         if (2.5 * tmp_move.value / 3 > my_move.value) {
           my_move = {
@@ -433,8 +486,8 @@ public:
       }
     }
 
-    // add my last move to the Vector with my moves so far
-    add_move(my_move.index, m_my_moves);
+    // add my last move to the clusters of my moves so far
+    add_move(game, my_move.index, m_my_moves);
 
     // if the current move is the one that I got from memory, remove it from
     // memory
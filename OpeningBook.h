@@ -0,0 +1,135 @@
+#ifndef OPENING_BOOK_H
+#define OPENING_BOOK_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "FacilityGame.h"
+#include "FacilityGameException.h"
+#include "MappedFile.h"
+#include "MoveLog.h"
+
+// The opening book format, after a magic:
+//   the varints MIN_VALUE, MAX_VALUE, BONUS_MIN_GROUP_SIZE and BONUS_FACTOR
+//   of the rules the book was made for
+//   the varint number of lines, then for every line the varint hash of its
+//   board, the varint number of moves and the moves as varints
+// A line is the first moves of a game on its board, of both players from the
+// empty board, so a player is in the book while the moves played so far are
+// a prefix of the line. Boards are told apart by the hash of their node
+// values, so a line is found for a board loaded from a file too.
+class OpeningBook {
+public:
+  static constexpr std::array<unsigned char, 8> MAGIC{
+      'F', 'A', 'C', 'B', 'O', 'O', 'K', '1'};
+
+private:
+  std::unordered_map<std::uint64_t, std::vector<std::size_t>> m_lines;
+
+public:
+  // FNV-1a over the size and the node values
+  [[nodiscard]] static std::uint64_t board_hash(FacilityGame const &game) {
+    constexpr std::uint64_t PRIME = 0x100000001B3ULL;
+    std::uint64_t hash = 0xCBF29CE484222325ULL;
+    hash = (hash ^ game.get_num_nodes()) * PRIME;
+    for (std::size_t const value : game.get_nodes()) {
+      hash = (hash ^ value) * PRIME;
+    }
+    return hash;
+  }
+
+  [[nodiscard]] std::size_t size() const {
+    return m_lines.size();
+  }
+
+  // the line of the board, replacing the one it had
+  void add(std::uint64_t hash, std::vector<std::size_t> moves) {
+    m_lines.insert_or_assign(hash, std::move(moves));
+  }
+
+  // the line of the board of the game, empty if it has none
+  [[nodiscard]] std::span<std::size_t const> find(
+      FacilityGame const &game) const {
+    auto const it = m_lines.find(board_hash(game));
+    if (it == m_lines.end()) {
+      return {};
+    }
+    return it->second;
+  }
+
+  void save(std::string const &path) const {
+    std::vector<unsigned char> out(MAGIC.begin(), MAGIC.end());
+    for (std::size_t const rule :
+         {MIN_VALUE, MAX_VALUE, BONUS_MIN_GROUP_SIZE, BONUS_FACTOR}) {
+      move_log::put_varint(out, rule);
+    }
+    // sorted by hash, so that the same book makes the same file
+    std::vector<std::uint64_t> hashes;
+    hashes.reserve(m_lines.size());
+    for (auto const &[hash, moves] : m_lines) {
+      hashes.push_back(hash);
+    }
+    std::ranges::sort(hashes);
+    move_log::put_varint(out, hashes.size());
+    for (std::uint64_t const hash : hashes) {
+      auto const &moves = m_lines.at(hash);
+      move_log::put_varint(out, hash);
+      move_log::put_varint(out, moves.size());
+      for (std::size_t const move : moves) {
+        move_log::put_varint(out, move);
+      }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(
+        reinterpret_cast<char const *>(out.data()),
+        static_cast<std::streamsize>(out.size()));
+    if (!file.flush()) {
+      throw FacilityGameException(("Cannot write book: " + path).c_str());
+    }
+  }
+
+  [[nodiscard]] static OpeningBook load(std::string const &path) {
+    MappedFile const file(path);
+    auto const bytes = file.bytes();
+    if (!std::ranges::equal(
+            bytes.first(std::min(bytes.size(), MAGIC.size())),
+            MAGIC)) {
+      MappedFile::fail("book " + path, "not an opening book");
+    }
+    move_log::Decoder in(bytes.subspan(MAGIC.size()));
+    for (std::size_t const rule :
+         {MIN_VALUE, MAX_VALUE, BONUS_MIN_GROUP_SIZE, BONUS_FACTOR}) {
+      if (in.varint() != rule) {
+        MappedFile::fail("book " + path, "made for other rules");
+      }
+    }
+    OpeningBook book;
+    std::uint64_t const num_lines = in.varint();
+    for (std::uint64_t line = 0; line < num_lines; ++line) {
+      std::uint64_t const hash = in.varint();
+      std::uint64_t const num_moves = in.varint();
+      if (num_moves > bytes.size()) {
+        MappedFile::fail("book " + path, "invalid number of moves");
+      }
+      std::vector<std::size_t> moves(num_moves);
+      for (auto &move : moves) {
+        move = in.varint();
+      }
+      book.add(hash, std::move(moves));
+    }
+    if (!in.empty()) {
+      MappedFile::fail("book " + path, "trailing bytes");
+    }
+    return book;
+  }
+};
+
+#endif // OPENING_BOOK_H
@@ -0,0 +1,166 @@
+#ifndef PACKED_STATUSES_H
+#define PACKED_STATUSES_H
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "enums.h"
+
+// The status of every node packed into two bit-planes of 64-bit words. The
+// high plane marks the occupied nodes (PLAYER_A or PLAYER_B) and the low plane
+// holds the low bit of the FacilityStatus value, i.e. it tells BLOCKED apart
+// from FREE and PLAYER_B apart from PLAYER_A.
+class PackedStatuses {
+public:
+  using word_t = std::uint64_t;
+  static constexpr std::size_t WORD_BITS = 64;
+
+private:
+  static_assert(static_cast<unsigned>(FacilityStatus::FREE) == 0b00);
+  static_assert(static_cast<unsigned>(FacilityStatus::BLOCKED) == 0b01);
+  static_assert(static_cast<unsigned>(FacilityStatus::PLAYER_A) == 0b10);
+  static_assert(static_cast<unsigned>(FacilityStatus::PLAYER_B) == 0b11);
+
+  std::size_t m_size;
+  std::vector<word_t> m_high;
+  std::vector<word_t> m_low;
+
+  [[nodiscard]] static constexpr word_t bit(std::size_t idx) {
+    return word_t{1} << (idx % WORD_BITS);
+  }
+
+public:
+  explicit PackedStatuses(std::size_t size)
+      : m_size(size),
+        m_high((size + WORD_BITS - 1) / WORD_BITS),
+        m_low(m_high.size()) {}
+
+  [[nodiscard]] std::size_t size() const {
+    return m_size;
+  }
+
+  [[nodiscard]] std::size_t num_words() const {
+    return m_high.size();
+  }
+
+  [[nodiscard]] FacilityStatus operator[](std::size_t idx) const {
+    std::size_t const word = idx / WORD_BITS;
+    std::size_t const shift = idx % WORD_BITS;
+    auto const high = (m_high[word] >> shift) & 1U;
+    auto const low = (m_low[word] >> shift) & 1U;
+    return static_cast<FacilityStatus>((high << 1U) | low);
+  }
+
+  void set(std::size_t idx, FacilityStatus status) {
+    auto const value = static_cast<unsigned>(status);
+    std::size_t const word = idx / WORD_BITS;
+    word_t const mask = bit(idx);
+    m_high[word] = (m_high[word] & ~mask) | ((value & 0b10U) ? mask : 0);
+    m_low[word] = (m_low[word] & ~mask) | ((value & 0b01U) ? mask : 0);
+  }
+
+  // turns the node into BLOCKED if it is FREE, and returns whether it did
+  bool block_if_free(std::size_t idx) {
+    std::size_t const word = idx / WORD_BITS;
+    word_t const free = ~(m_high[word] | m_low[word]) & bit(idx);
+    m_low[word] |= free;
+    return free != 0;
+  }
+
+  void clear() {
+    std::ranges::fill(m_high, 0);
+    std::ranges::fill(m_low, 0);
+  }
+
+  // the two bit-planes, e.g. to save them
+  [[nodiscard]] std::span<word_t const> high_words() const {
+    return m_high;
+  }
+
+  [[nodiscard]] std::span<word_t const> low_words() const {
+    return m_low;
+  }
+
+  // the bits of the word which correspond to nodes of the board
+  [[nodiscard]] word_t valid_mask(std::size_t word) const {
+    std::size_t const tail = m_size % WORD_BITS;
+    if (word + 1 < m_high.size() || tail == 0) {
+      return ~word_t{0};
+    }
+    return (word_t{1} << tail) - 1;
+  }
+
+  [[nodiscard]] word_t free_mask(std::size_t word) const {
+    return ~(m_high[word] | m_low[word]) & valid_mask(word);
+  }
+
+  [[nodiscard]] word_t blocked_mask(std::size_t word) const {
+    return ~m_high[word] & m_low[word];
+  }
+
+  [[nodiscard]] word_t player_mask(std::size_t word, Player player) const {
+    if (player == Player::PLAYER_A) {
+      return m_high[word] & ~m_low[word];
+    }
+    return m_high[word] & m_low[word];
+  }
+
+  [[nodiscard]] std::size_t count(FacilityStatus status) const {
+    std::size_t num{};
+    for (std::size_t word = 0; word < m_high.size(); ++word) {
+      word_t mask{};
+      switch (status) {
+      case FacilityStatus::FREE: {
+        mask = free_mask(word);
+        break;
+      }
+      case FacilityStatus::BLOCKED: {
+        mask = blocked_mask(word);
+        break;
+      }
+      case FacilityStatus::PLAYER_A: {
+        mask = player_mask(word, Player::PLAYER_A);
+        break;
+      }
+      case FacilityStatus::PLAYER_B: {
+        mask = player_mask(word, Player::PLAYER_B);
+        break;
+      }
+      }
+      num += static_cast<std::size_t>(std::popcount(mask));
+    }
+    return num;
+  }
+
+  // the first FREE node at or after `from`, or size() if there is none
+  [[nodiscard]] std::size_t find_first_free(std::size_t from = 0) const {
+    if (from >= m_size) {
+      return m_size;
+    }
+    std::size_t word = from / WORD_BITS;
+    word_t mask = free_mask(word) & (~word_t{0} << (from % WORD_BITS));
+    while (mask == 0) {
+      if (++word == m_high.size()) {
+        return m_size;
+      }
+      mask = free_mask(word);
+    }
+    return word * WORD_BITS + static_cast<std::size_t>(std::countr_zero(mask));
+  }
+
+  // the last FREE node, or size() if there is none
+  [[nodiscard]] std::size_t find_last_free() const {
+    for (std::size_t word = m_high.size(); word > 0; --word) {
+      if (word_t const mask = free_mask(word - 1); mask != 0) {
+        return (word - 1) * WORD_BITS + WORD_BITS - 1
+               - static_cast<std::size_t>(std::countl_zero(mask));
+      }
+    }
+    return m_size;
+  }
+};
+
+#endif // PACKED_STATUSES_H
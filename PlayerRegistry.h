@@ -0,0 +1,92 @@
+#ifndef PLAYER_REGISTRY_H
+#define PLAYER_REGISTRY_H
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "FPlayer.h"
+#include "FPlayerAlphaBeta.h"
+#include "FPlayerHighest.h"
+#include "FPlayerLinear.h"
+#include "FPlayerMCTS.h"
+#include "FPlayerRandom.h"
+#include "FPlayerSlow.h"
+#include "FacilityGameException.h"
+#include "NightHawk.h"
+
+struct PlayerEntry {
+  std::string name;
+  std::function<std::unique_ptr<FPlayer>(Player)> create;
+};
+
+static constexpr std::size_t ALPHA_BETA_MAX_NODES = 20000;
+static constexpr std::size_t MCTS_MAX_PLAYOUTS = 2000;
+
+template <typename PlayerT>
+PlayerEntry make_player_entry(char const *name) {
+  return {name, [](Player player) -> std::unique_ptr<FPlayer> {
+            return std::make_unique<PlayerT>(player);
+          }};
+}
+
+// the players which can be selected at runtime; FPlayerSlow is left out,
+// since it sleeps for more than 20 sec per move, see slow_player; the search
+// players are limited by nodes or playouts instead of time, so that their
+// games are reproducible; MCTS runs on a single thread, since the tournament
+// already keeps all the cores busy
+inline std::vector<PlayerEntry> const &registered_players() {
+  static std::vector<PlayerEntry> const players{
+      make_player_entry<FPlayerLinear>("Linear"),
+      make_player_entry<FPlayerRandom>("Random"),
+      make_player_entry<FPlayerHighest>("Highest"),
+      make_player_entry<NightHawk>("NightHawk"),
+      {"AlphaBeta",
+       [](Player player) -> std::unique_ptr<FPlayer> {
+         return std::make_unique<FPlayerAlphaBeta>(
+             player,
+             SearchLimits{
+                 .max_nodes = ALPHA_BETA_MAX_NODES,
+                 .max_time = std::chrono::minutes(1)});
+       }},
+      {"MCTS",
+       [](Player player) -> std::unique_ptr<FPlayer> {
+         return std::make_unique<FPlayerMCTS>(
+             player,
+             MCTSLimits{
+                 .num_threads = 1,
+                 .max_playouts = MCTS_MAX_PLAYOUTS,
+                 .max_time = std::chrono::minutes(1)});
+       }},
+  };
+  return players;
+}
+
+// FPlayerSlow, which can only be selected for games with a time limit per
+// move, where it shows what happens to a player which runs late
+inline PlayerEntry const &slow_player() {
+  static PlayerEntry const entry = make_player_entry<FPlayerSlow>("Slow");
+  return entry;
+}
+
+inline PlayerEntry const &find_player(
+    std::string_view name,
+    bool time_control = false) {
+  if (name == slow_player().name) {
+    if (!time_control) {
+      throw FacilityGameException("Slow only plays with --move-time");
+    }
+    return slow_player();
+  }
+  for (auto const &entry : registered_players()) {
+    if (entry.name == name) {
+      return entry;
+    }
+  }
+  throw FacilityGameException(
+      ("Unknown player: " + std::string(name)).c_str());
+}
+
+#endif // PLAYER_REGISTRY_H
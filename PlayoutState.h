@@ -0,0 +1,133 @@
+#ifndef PLAYOUT_STATE_H
+#define PLAYOUT_STATE_H
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "FacilityGame.h"
+
+// A stripped down copy of a FacilityGame position for random playouts: the
+// unpacked statuses and a list of the free nodes, so that a random free node is
+// picked and removed in O(1). There are no checks, no scores and no move list,
+// and assign() reuses the buffers, so a playout does not allocate once the
+// buffers have grown to the size of the board.
+class PlayoutState {
+private:
+  FacilityGame const *m_game{};
+  std::vector<FacilityStatus> m_statuses;
+  std::vector<std::size_t> m_free;
+  // the position of every free node in m_free
+  std::vector<std::size_t> m_free_pos;
+  Player m_player{Player::PLAYER_A};
+
+  void remove_free(std::size_t idx) {
+    std::size_t const pos = m_free_pos[idx];
+    std::size_t const last = m_free.back();
+    m_free[pos] = last;
+    m_free_pos[last] = pos;
+    m_free.pop_back();
+  }
+
+  void block_if_free(std::size_t idx) {
+    if (m_statuses[idx] == FacilityStatus::FREE) {
+      m_statuses[idx] = FacilityStatus::BLOCKED;
+      remove_free(idx);
+    }
+  }
+
+public:
+  void assign(FacilityGame const &game) {
+    std::size_t const n = game.get_num_nodes();
+    m_game = &game;
+    m_statuses.resize(n);
+    m_free_pos.resize(n);
+    m_free.clear();
+    for (std::size_t idx = 0; idx < n; ++idx) {
+      m_statuses[idx] = game.get_status(idx);
+      if (m_statuses[idx] == FacilityStatus::FREE) {
+        m_free_pos[idx] = m_free.size();
+        m_free.push_back(idx);
+      }
+    }
+    m_player = game.get_player_to_move();
+  }
+
+  [[nodiscard]] bool is_finished() const {
+    return m_free.empty();
+  }
+
+  void play(std::size_t idx) {
+    m_statuses[idx] = m_player == Player::PLAYER_A ? FacilityStatus::PLAYER_A
+                                                   : FacilityStatus::PLAYER_B;
+    remove_free(idx);
+    if (m_statuses.size() > 2) {
+      if (idx > 0) {
+        block_if_free(idx - 1);
+      }
+      if (idx + 1 < m_statuses.size()) {
+        block_if_free(idx + 1);
+      }
+    }
+    m_player =
+        m_player == Player::PLAYER_A ? Player::PLAYER_B : Player::PLAYER_A;
+  }
+
+  // plays uniformly random moves until the board is full
+  template <typename Rng>
+  void play_random(Rng &gen) {
+    while (!m_free.empty()) {
+      std::size_t const pos =
+          std::uniform_int_distribution<std::size_t>(0, m_free.size() - 1)(
+              gen);
+      play(m_free[pos]);
+    }
+  }
+
+  // the scores of PLAYER_A and PLAYER_B, computed in a single pass
+  [[nodiscard]] std::pair<std::size_t, std::size_t> scores() const {
+    struct Run {
+      std::size_t sum{};
+      std::size_t size{};
+      std::size_t score{};
+
+      void close() {
+        score += size >= BONUS_MIN_GROUP_SIZE ? sum * BONUS_FACTOR : sum;
+        sum = 0;
+        size = 0;
+      }
+    };
+
+    Run a;
+    Run b;
+    for (std::size_t idx = 0; idx < m_statuses.size(); ++idx) {
+      switch (m_statuses[idx]) {
+      case FacilityStatus::FREE: {
+        a.close();
+        b.close();
+        break;
+      }
+      case FacilityStatus::BLOCKED: {
+        break;
+      }
+      case FacilityStatus::PLAYER_A: {
+        a.sum += m_game->get_node(idx);
+        ++a.size;
+        b.close();
+        break;
+      }
+      case FacilityStatus::PLAYER_B: {
+        b.sum += m_game->get_node(idx);
+        ++b.size;
+        a.close();
+        break;
+      }
+      }
+    }
+    a.close();
+    b.close();
+    return {a.score, b.score};
+  }
+};
+
+#endif // PLAYOUT_STATE_H
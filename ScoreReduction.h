@@ -0,0 +1,286 @@
+#ifndef SCORE_REDUCTION_H
+#define SCORE_REDUCTION_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "FacilityGame.h"
+#include "PackedStatuses.h"
+#include "ThreadPool.h"
+#include "enums.h"
+
+// the nodes of one player in a run which no FREE or opponent node ends
+struct GroupRun {
+  std::size_t sum{};
+  std::size_t size{};
+
+  [[nodiscard]] std::size_t score() const {
+    return size >= BONUS_MIN_GROUP_SIZE ? sum * BONUS_FACTOR : sum;
+  }
+
+  GroupRun &operator+=(GroupRun const &other) {
+    sum += other.sum;
+    size += other.size;
+    return *this;
+  }
+};
+
+// The groups of one player in a part of the board: the run at its start,
+// the score of the groups which both start and end inside it, and the run
+// at its end. A part where nothing ends a group, e.g. one of only BLOCKED
+// nodes, is a single open run, kept in first. Joining the summaries of two
+// neighboring parts is associative, which is what lets the parts of a board
+// be scored independently.
+struct GroupSummary {
+  GroupRun first;
+  std::size_t interior{};
+  GroupRun last;
+  bool closed{};
+
+  [[nodiscard]] std::size_t score() const {
+    return closed ? first.score() + interior + last.score() : first.score();
+  }
+
+  // the summary of this part followed by the next one
+  GroupSummary &operator+=(GroupSummary const &next) {
+    if (!closed) {
+      first += next.first;
+      if (next.closed) {
+        interior = next.interior;
+        last = next.last;
+        closed = true;
+      }
+    } else if (!next.closed) {
+      last += next.first;
+    } else {
+      last += next.first;
+      interior += last.score() + next.interior;
+      last = next.last;
+    }
+    return *this;
+  }
+};
+
+// Scores both players in one pass over the statuses, 64 nodes at a time. A
+// word is summarized from bit masks: the nodes which end a group of a player
+// are the valid nodes which are neither the player's nor BLOCKED, the runs
+// between them are found with countr_zero, and the one-byte node values of
+// both players are added eight at a time in the lanes of a 64-bit word,
+// which needs no instruction set beyond the baseline. Ranges of words are
+// summarized on their own and joined in order, on a thread pool for large
+// boards.
+template <typename Node>
+class ScoreReduction {
+private:
+  using word_t = PackedStatuses::word_t;
+  static constexpr std::size_t WORD_BITS = PackedStatuses::WORD_BITS;
+  // words per task, so that a task reads about 128 KiB of node values
+  static constexpr std::size_t CHUNK_WORDS = 2048;
+
+  PackedStatuses const &m_statuses;
+  std::span<Node const> m_nodes;
+
+  [[nodiscard]] static std::size_t sum_bits(Node const *values, word_t mask) {
+    std::size_t sum{};
+    for (; mask != 0; mask &= mask - 1) {
+      sum += values[std::countr_zero(mask)];
+    }
+    return sum;
+  }
+
+  static_assert(BONUS_MIN_GROUP_SIZE == 3);
+
+  // the masks of one player in a word: the run at its start, the run at its
+  // end, and the groups inside which get the bonus
+  struct WordMasks {
+    word_t first{};
+    word_t last{};
+    word_t bonus{};
+    bool closed{};
+  };
+
+  // the bits of path which are reached from the bits of from by going up, or
+  // down, without leaving path, in log2(64) steps
+  [[nodiscard]] static word_t fill_up(word_t from, word_t path) {
+    for (unsigned shift = 1; shift < WORD_BITS; shift *= 2) {
+      from |= path & (from << shift);
+      path &= path << shift;
+    }
+    return from;
+  }
+
+  [[nodiscard]] static word_t fill_down(word_t from, word_t path) {
+    for (unsigned shift = 1; shift < WORD_BITS; shift *= 2) {
+      from |= path & (from >> shift);
+      path &= path >> shift;
+    }
+    return from;
+  }
+
+  [[nodiscard]] static WordMasks masks(word_t mine, word_t ends) {
+    if (ends == 0) {
+      return {.first = mine};
+    }
+    auto const first_end = static_cast<unsigned>(std::countr_zero(ends));
+    auto const last_end =
+        WORD_BITS - 1 - static_cast<std::size_t>(std::countl_zero(ends));
+    word_t const before = (word_t{1} << first_end) - 1;
+    word_t const after = ~word_t{1} << last_end;
+    word_t const inner = mine & ~before & ~after;
+    // a group of three or more has a node with another one of the group on
+    // either side of it, and the groups with such a node get the bonus
+    word_t const path = ~ends;
+    word_t const middle =
+        inner & (fill_up(inner, path) << 1U) & (fill_down(inner, path) >> 1U);
+    WordMasks result{
+        .first = mine & before,
+        .last = mine & after,
+        .bonus =
+            inner & (fill_up(middle, path) | fill_down(middle, path)),
+        .closed = true};
+    return result;
+  }
+
+  // the sums of the values of a word under every mask; for a whole word of
+  // one-byte values, every byte of a mask is spread to a byte mask, and the
+  // selected values are added in 16-bit lanes, which cannot overflow since
+  // 16 values of at most 255 are added in each; the bytes of a mask map to
+  // the values loaded into a word in little-endian order only, so other
+  // targets add the values one by one
+  template <std::size_t N>
+  [[nodiscard]] static std::array<std::size_t, N> sum_values(
+      Node const *values,
+      word_t valid,
+      std::array<word_t, N> const &bits) {
+    std::array<std::size_t, N> sums{};
+    if (!std::is_same_v<Node, std::uint8_t>
+        || std::endian::native != std::endian::little || valid != ~word_t{0}) {
+      for (std::size_t idx = 0; idx < N; ++idx) {
+        sums[idx] = sum_bits(values, bits[idx]);
+      }
+      return sums;
+    }
+    constexpr word_t SPREAD = 0x0101010101010101ULL;
+    constexpr word_t BIT_OF_BYTE = 0x8040201008040201ULL;
+    constexpr word_t LOW_7 = 0x7F7F7F7F7F7F7F7FULL;
+    constexpr word_t HIGH = 0x8080808080808080ULL;
+    constexpr word_t EVEN_BYTES = 0x00FF00FF00FF00FFULL;
+    constexpr word_t SUM_LANES = 0x0001000100010001ULL;
+    std::array<word_t, N> lanes{};
+    for (unsigned byte = 0; byte < sizeof(word_t); ++byte) {
+      word_t chunk{};
+      std::memcpy(&chunk, values + byte * sizeof(word_t), sizeof(word_t));
+      for (std::size_t idx = 0; idx < N; ++idx) {
+        word_t const spread =
+            ((bits[idx] >> (byte * 8)) & 0xFFU) * SPREAD & BIT_OF_BYTE;
+        word_t const selected =
+            chunk & ((((spread + LOW_7) | spread) & HIGH) >> 7U) * 0xFFU;
+        lanes[idx] +=
+            (selected & EVEN_BYTES) + ((selected >> 8U) & EVEN_BYTES);
+      }
+    }
+    for (std::size_t idx = 0; idx < N; ++idx) {
+      sums[idx] = (lanes[idx] * SUM_LANES) >> 48U;
+    }
+    return sums;
+  }
+
+  // the summaries of both players over the words [first, last)
+  [[nodiscard]] std::array<GroupSummary, 2> summarize(
+      std::size_t first,
+      std::size_t last) const {
+    auto const high = m_statuses.high_words();
+    auto const low = m_statuses.low_words();
+    std::array<GroupSummary, 2> summaries{};
+    for (std::size_t word = first; word < last; ++word) {
+      word_t const valid = m_statuses.valid_mask(word);
+      word_t const blocked = ~high[word] & low[word];
+      word_t const mine_a = high[word] & ~low[word];
+      word_t const mine_b = high[word] & low[word];
+      auto const a = masks(mine_a, valid & ~(mine_a | blocked));
+      auto const b = masks(mine_b, valid & ~(mine_b | blocked));
+      Node const *values = m_nodes.data() + word * WORD_BITS;
+      auto const sums = sum_values<2>(values, valid, {mine_a, mine_b});
+      summaries[0] += summary(values, a, sums[0]);
+      summaries[1] += summary(values, b, sums[1]);
+    }
+    return summaries;
+  }
+
+  // the summary of a word of a player, whose values add up to sum; the
+  // groups with the bonus are few, so they are added node by node
+  [[nodiscard]] static GroupSummary summary(
+      Node const *values,
+      WordMasks const &word,
+      std::size_t sum) {
+    GroupSummary result;
+    result.first.sum = sum_bits(values, word.first);
+    result.first.size = static_cast<std::size_t>(std::popcount(word.first));
+    result.last.sum = sum_bits(values, word.last);
+    result.last.size = static_cast<std::size_t>(std::popcount(word.last));
+    result.interior = sum - result.first.sum - result.last.sum
+                      + (BONUS_FACTOR - 1) * sum_bits(values, word.bonus);
+    result.closed = word.closed;
+    return result;
+  }
+
+  [[nodiscard]] static std::array<std::size_t, 2>
+  scores(std::array<GroupSummary, 2> const &summaries) {
+    return {summaries[0].score(), summaries[1].score()};
+  }
+
+public:
+  ScoreReduction(PackedStatuses const &statuses, std::span<Node const> nodes)
+      : m_statuses(statuses),
+        m_nodes(nodes) {}
+
+  // the scores of PLAYER_A and PLAYER_B
+  [[nodiscard]] std::array<std::size_t, 2> compute() const {
+    return scores(summarize(0, m_statuses.num_words()));
+  }
+
+  // the same, with the words split in chunks which the pool summarizes in
+  // parallel
+  [[nodiscard]] std::array<std::size_t, 2> compute(ThreadPool &pool) const {
+    std::size_t const num_words = m_statuses.num_words();
+    std::size_t const num_chunks = (num_words + CHUNK_WORDS - 1) / CHUNK_WORDS;
+    if (num_chunks <= 1 || pool.num_threads() <= 1) {
+      return compute();
+    }
+    std::vector<std::array<GroupSummary, 2>> chunks(num_chunks);
+    pool.parallel_for(num_chunks, [this, &chunks, num_words](std::size_t idx) {
+      chunks[idx] = summarize(
+          idx * CHUNK_WORDS,
+          std::min((idx + 1) * CHUNK_WORDS, num_words));
+    });
+    std::array<GroupSummary, 2> summaries{};
+    for (auto const &chunk : chunks) {
+      summaries[0] += chunk[0];
+      summaries[1] += chunk[1];
+    }
+    return scores(summaries);
+  }
+};
+
+// the scores of both players of the game, from its statuses
+template <typename Node>
+[[nodiscard]] std::array<std::size_t, 2> compute_scores(
+    BasicFacilityGame<Node> const &game) {
+  return ScoreReduction<Node>(game.get_statuses(), game.get_nodes()).compute();
+}
+
+template <typename Node>
+[[nodiscard]] std::array<std::size_t, 2> compute_scores(
+    BasicFacilityGame<Node> const &game,
+    ThreadPool &pool) {
+  return ScoreReduction<Node>(game.get_statuses(), game.get_nodes())
+      .compute(pool);
+}
+
+#endif // SCORE_REDUCTION_H
@@ -0,0 +1,275 @@
+#ifndef SELF_CHECK_H
+#define SELF_CHECK_H
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <fmt/core.h>
+#include <limits>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "EndgameSolver.h"
+#include "FacilityGame.h"
+#include "FacilityGameException.h"
+#include "ScoreReduction.h"
+#include "ThreadPool.h"
+#include "enums.h"
+
+// Randomized checks of the incremental structures of the engine against
+// their reference implementations, run by `facility_game self-check` and by
+// ctest. A check throws a FacilityGameException on the first mismatch.
+namespace self_check {
+
+[[noreturn]] inline void fail(std::string const &what) {
+  throw FacilityGameException(("self-check failed: " + what).c_str());
+}
+
+// a random FREE node of a game which is not finished
+inline std::size_t random_free(FacilityGame const &game, std::mt19937 &gen) {
+  auto const &statuses = game.get_statuses();
+  std::uniform_int_distribution<std::size_t> dist(0, game.get_num_nodes() - 1);
+  std::size_t const idx = statuses.find_first_free(dist(gen));
+  return idx < game.get_num_nodes() ? idx : statuses.find_first_free();
+}
+
+// plays random legal games, taking back a move now and then, and compares
+// the incremental scores and number of FREE nodes with full scans after
+// every move and every undo
+inline void check_scores(std::size_t num_games, std::size_t seed) {
+  constexpr std::array<std::size_t, 9> SIZES{1, 2, 3, 4, 5, 10, 64, 65, 200};
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> undo(0, 3);
+  std::size_t num_moves{};
+  for (std::size_t game_idx = 0; game_idx < num_games; ++game_idx) {
+    std::size_t const size = SIZES[game_idx % SIZES.size()];
+    FacilityGame game(size, seed + game_idx);
+    auto check = [&game, game_idx]() {
+      for (auto const player : {Player::PLAYER_A, Player::PLAYER_B}) {
+        if (game.get_score(player) != game.compute_score(player)) {
+          fail(fmt::format(
+              "game {}: the score of {} is {} instead of {} after {} moves",
+              game_idx,
+              player_to_str(player),
+              game.get_score(player),
+              game.compute_score(player),
+              game.get_moves().size()));
+        }
+      }
+      if (game.num_free()
+          != game.get_statuses().count(FacilityStatus::FREE)) {
+        fail(fmt::format("game {}: wrong number of FREE nodes", game_idx));
+      }
+    };
+    check();
+    while (!game.is_finished()) {
+      if (!game.get_moves().empty() && undo(gen) == 0) {
+        game.undo_move();
+      } else {
+        game.append_move(game.get_player_to_move(), random_free(game, gen));
+        ++num_moves;
+      }
+      check();
+    }
+  }
+  fmt::println("scores: {} games, {} moves checked", num_games, num_moves);
+}
+
+// plays random partial games and compares the scores of the word-wise
+// reduction, serial and on a thread pool, with the incremental ones; the
+// moves go near the ends of the words and of the chunks of a task, where the
+// reduction joins the groups of its parts
+inline void check_reduction(std::size_t num_games, std::size_t seed) {
+  // a task of ScoreReduction reads 2048 words of 64 nodes
+  constexpr std::size_t CHUNK_NODES = 2048 * 64;
+  constexpr std::array<std::size_t, 5> SIZES{
+      63, 64, 65, 130, 2 * CHUNK_NODES + 65};
+  constexpr std::size_t MAX_MOVES = 300;
+  constexpr std::size_t CHECK_EVERY = 16;
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<std::size_t> offset(0, 140);
+  ThreadPool pool(4);
+  std::size_t num_checks{};
+  for (std::size_t game_idx = 0; game_idx < num_games; ++game_idx) {
+    std::size_t const size = SIZES[game_idx % SIZES.size()];
+    FacilityGame game(size, seed + game_idx);
+    auto check = [&game, &pool, game_idx]() {
+      std::array const expected{
+          game.get_score(Player::PLAYER_A),
+          game.get_score(Player::PLAYER_B)};
+      if (compute_scores(game) != expected
+          || compute_scores(game, pool) != expected) {
+        fail(fmt::format(
+            "game {}: the reduced scores on {} nodes differ after {} moves",
+            game_idx,
+            game.get_num_nodes(),
+            game.get_moves().size()));
+      }
+    };
+    std::size_t const num_moves =
+        std::uniform_int_distribution<std::size_t>(0, MAX_MOVES)(gen);
+    std::uniform_int_distribution<std::size_t> boundary(
+        0, (size - 1) / CHUNK_NODES + 1);
+    for (std::size_t move = 0; move < num_moves && !game.is_finished();
+         ++move) {
+      // around a chunk boundary, wrapped into the board
+      std::size_t const near = boundary(gen) * CHUNK_NODES + size - 70;
+      std::size_t idx = game.get_statuses().find_first_free(
+          (near + offset(gen)) % size);
+      if (idx >= size) {
+        idx = game.get_statuses().find_first_free();
+      }
+      game.append_move(game.get_player_to_move(), idx);
+      if (move % CHECK_EVERY == 0) {
+        check();
+        ++num_checks;
+      }
+    }
+    check();
+    ++num_checks;
+  }
+  fmt::println(
+      "reduction: {} games, {} positions checked", num_games, num_checks);
+}
+
+// plays on a board with more nodes than 2^32 / MAX_VALUE, where the node
+// indices times the values do not fit into 32 bits: a long group of each
+// player at either end of the board, taking back a move now and then, and
+// compares the scores and the group records with full scans
+inline void check_large(std::size_t seed) {
+  constexpr std::size_t SIZE =
+      (std::size_t{1} << 32U) / MAX_VALUE + 1000;
+  constexpr std::size_t GROUP_SIZE = 1000;
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> undo(0, 3);
+  FacilityGame game(SIZE, seed);
+  std::size_t num_moves{};
+  while (num_moves < 2 * GROUP_SIZE) {
+    if (!game.get_moves().empty() && undo(gen) == 0) {
+      game.undo_move();
+      --num_moves;
+      continue;
+    }
+    // PLAYER_A plays every other node from the end, PLAYER_B from the start
+    std::size_t const step = num_moves / 2;
+    game.append_move(
+        game.get_player_to_move(),
+        game.get_player_to_move() == Player::PLAYER_A ? SIZE - 1 - 2 * step
+                                                      : 2 * step);
+    ++num_moves;
+  }
+
+  std::size_t sum{};
+  for (std::size_t step = 0; step < GROUP_SIZE; ++step) {
+    sum += game.get_node(SIZE - 1 - 2 * step);
+  }
+  auto const [group_sum, group_size] = game.get_group(SIZE - 1);
+  if (group_sum != sum || group_size != GROUP_SIZE
+      || game.get_group_other_end(SIZE - 1)
+             != SIZE - 1 - 2 * (GROUP_SIZE - 1)) {
+    fail("the group at the end of the board is wrong");
+  }
+  for (auto const player : {Player::PLAYER_A, Player::PLAYER_B}) {
+    if (game.get_score(player) != game.compute_score(player)) {
+      fail(fmt::format(
+          "the score of {} is {} instead of {} on {} nodes",
+          player_to_str(player),
+          game.get_score(player),
+          game.compute_score(player),
+          SIZE));
+    }
+  }
+  auto const highest = game.highest_free();
+  if (!highest || game.get_status(*highest) != FacilityStatus::FREE
+      || game.get_node(*highest) != MAX_VALUE) {
+    fail("the highest FREE node is wrong");
+  }
+  fmt::println("large: {} nodes, {} moves checked", SIZE, num_moves);
+}
+
+// the final score difference for the player to move with perfect play, by a
+// plain minimax over every move, memoized by the hash of the position
+inline EndgameSolver::value_t brute_force(
+    FacilityGame &game,
+    std::unordered_map<std::uint64_t, EndgameSolver::value_t> &memo) {
+  Player const player = game.get_player_to_move();
+  if (game.is_finished()) {
+    Player const other =
+        player == Player::PLAYER_A ? Player::PLAYER_B : Player::PLAYER_A;
+    return static_cast<EndgameSolver::value_t>(game.get_score(player))
+           - static_cast<EndgameSolver::value_t>(game.get_score(other));
+  }
+  if (auto const it = memo.find(game.get_hash()); it != memo.end()) {
+    return it->second;
+  }
+  auto best = std::numeric_limits<EndgameSolver::value_t>::min();
+  auto const &statuses = game.get_statuses();
+  for (std::size_t idx = statuses.find_first_free();
+       idx < game.get_num_nodes();
+       idx = statuses.find_first_free(idx + 1)) {
+    game.append_move(player, idx);
+    best = std::max(best, -brute_force(game, memo));
+    game.undo_move();
+  }
+  memo.emplace(game.get_hash(), best);
+  return best;
+}
+
+// plays random games down to a few FREE nodes, then solves every remaining
+// position with one EndgameSolver, which keeps its cached components across
+// the games, and compares its value and the value of its move with a brute
+// force search
+inline void check_endgame(std::size_t num_games, std::size_t seed) {
+  constexpr std::array<std::size_t, 9> SIZES{1, 2, 3, 4, 5, 10, 17, 30, 64};
+  constexpr std::size_t MAX_FREE = 10;
+  std::mt19937 gen(seed);
+  EndgameSolver solver(12);
+  std::size_t num_positions{};
+  for (std::size_t game_idx = 0; game_idx < num_games; ++game_idx) {
+    std::size_t const size = SIZES[game_idx % SIZES.size()];
+    FacilityGame game(size, seed + game_idx);
+    while (game.num_free() > MAX_FREE) {
+      game.append_move(game.get_player_to_move(), random_free(game, gen));
+    }
+    solver.clear();
+    std::unordered_map<std::uint64_t, EndgameSolver::value_t> memo;
+    while (!game.is_finished()) {
+      auto const result =
+          solver.solve(game, std::numeric_limits<std::size_t>::max());
+      if (!result) {
+        fail(fmt::format("game {}: no endgame result", game_idx));
+      }
+      auto const expected = brute_force(game, memo);
+      if (result->value != expected) {
+        fail(fmt::format(
+            "game {}: endgame value {} instead of {} with {} FREE nodes",
+            game_idx,
+            result->value,
+            expected,
+            game.num_free()));
+      }
+      if (!game.append_move(game.get_player_to_move(), result->move)) {
+        fail(fmt::format("game {}: illegal endgame move", game_idx));
+      }
+      if (-brute_force(game, memo) != expected) {
+        fail(fmt::format(
+            "game {}: endgame move {} is not the best",
+            game_idx,
+            result->move));
+      }
+      game.undo_move();
+      game.append_move(game.get_player_to_move(), random_free(game, gen));
+      ++num_positions;
+    }
+  }
+  fmt::println(
+      "endgame: {} games, {} positions checked",
+      num_games,
+      num_positions);
+}
+
+} // namespace self_check
+
+#endif // SELF_CHECK_H
@@ -0,0 +1,207 @@
+#ifndef SPRT_H
+#define SPRT_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+
+#include "FacilityGameException.h"
+
+struct SprtConfig {
+  // the Elo difference of A over B under the hypotheses H0 and H1
+  double elo0{0};
+  double elo1{20};
+  // the probabilities of accepting H1 when H0 holds, and H0 when H1 holds
+  double alpha{0.05};
+  double beta{0.05};
+};
+
+enum class SprtResult { CONTINUE, ACCEPT_H0, ACCEPT_H1 };
+
+// The running mean and variance of a series, with Welford's update, e.g. of
+// the score margins of A over B.
+class RunningStats {
+private:
+  std::size_t m_count{};
+  double m_mean{};
+  double m_m2{};
+
+public:
+  void add(double value) {
+    ++m_count;
+    double const delta = value - m_mean;
+    m_mean += delta / static_cast<double>(m_count);
+    m_m2 += delta * (value - m_mean);
+  }
+
+  [[nodiscard]] std::size_t count() const {
+    return m_count;
+  }
+
+  [[nodiscard]] double mean() const {
+    return m_mean;
+  }
+
+  [[nodiscard]] double variance() const {
+    return m_count > 1 ? m_m2 / static_cast<double>(m_count - 1) : 0;
+  }
+
+  // the half width of the 95% confidence interval of the mean
+  [[nodiscard]] double ci95() const {
+    constexpr double Z_95 = 1.959964;
+    return m_count > 1
+               ? Z_95 * std::sqrt(variance() / static_cast<double>(m_count))
+               : 0;
+  }
+};
+
+// The sequential probability ratio test of A against B, on pairs of games
+// on the same board with the seats swapped. A game scores 1 for a win of A,
+// 1/2 for a draw and 0 for a loss, so a pair scores 0, 1/2, ..., 2, and the
+// test counts the pairs by their score: the pentanomial model, which keeps
+// the correlation of the two games of a board, e.g. the advantage of the
+// first player, out of the variance. The log-likelihood ratio of H1 over H0
+// is approximated from the mean and the variance of the pair scores, in the
+// generalized form used for chess engines, and the test stops once it
+// leaves the bounds set by alpha and beta.
+class Sprt {
+public:
+  // the scores of A and B in one game
+  using GameScores = std::array<std::size_t, 2>;
+
+private:
+  static constexpr std::size_t NUM_PAIR_SCORES = 5;
+
+  SprtConfig m_config;
+  std::size_t m_wins{};
+  std::size_t m_draws{};
+  std::size_t m_losses{};
+  // the pairs by the score of A in half points
+  std::array<std::size_t, NUM_PAIR_SCORES> m_pairs{};
+
+  // the expected score of a player this many Elo stronger
+  [[nodiscard]] static double expected_score(double elo) {
+    return 1 / (1 + std::pow(10, -elo / 400));
+  }
+
+  // the score of A in half points
+  std::size_t add_game(GameScores const &scores) {
+    auto const [score_a, score_b] = scores;
+    if (score_a > score_b) {
+      ++m_wins;
+      return 2;
+    }
+    if (score_b > score_a) {
+      ++m_losses;
+      return 0;
+    }
+    ++m_draws;
+    return 1;
+  }
+
+public:
+  explicit Sprt(SprtConfig config) : m_config(config) {
+    if (!(config.alpha > 0 && config.alpha < 1)
+        || !(config.beta > 0 && config.beta < 1)) {
+      throw FacilityGameException("alpha and beta must be between 0 and 1");
+    }
+    if (!(config.elo1 > config.elo0)) {
+      throw FacilityGameException("elo1 must be larger than elo0");
+    }
+  }
+
+  // the two games of a board, with A in either seat
+  void add_pair(GameScores const &first, GameScores const &second) {
+    ++m_pairs[add_game(first) + add_game(second)];
+  }
+
+  [[nodiscard]] std::size_t wins() const {
+    return m_wins;
+  }
+
+  [[nodiscard]] std::size_t draws() const {
+    return m_draws;
+  }
+
+  [[nodiscard]] std::size_t losses() const {
+    return m_losses;
+  }
+
+  [[nodiscard]] std::size_t games() const {
+    return m_wins + m_draws + m_losses;
+  }
+
+  [[nodiscard]] std::size_t pairs() const {
+    return games() / 2;
+  }
+
+  // the number of pairs in which A scored half_points / 2
+  [[nodiscard]] std::size_t pairs_with(std::size_t half_points) const {
+    return m_pairs[half_points];
+  }
+
+  // the mean score of A per game
+  [[nodiscard]] double score() const {
+    return games() == 0 ? 0.5
+                        : (static_cast<double>(m_wins)
+                           + static_cast<double>(m_draws) / 2)
+                              / static_cast<double>(games());
+  }
+
+  // the Elo difference of A over B which its mean score corresponds to
+  [[nodiscard]] double elo() const {
+    double const s = score();
+    if (s <= 0 || s >= 1) {
+      double const inf = std::numeric_limits<double>::infinity();
+      return s <= 0 ? -inf : inf;
+    }
+    return -400 * std::log10(1 / s - 1);
+  }
+
+  // the pair scores are scaled to [0, 1]; every pair score is counted half
+  // a pair more, so that the variance is not zero while all the pairs have
+  // had the same score so far
+  [[nodiscard]] double llr() const {
+    if (pairs() == 0) {
+      return 0;
+    }
+    double n{};
+    double sum{};
+    double sum_squares{};
+    for (std::size_t half_points = 0; half_points < NUM_PAIR_SCORES;
+         ++half_points) {
+      double const count = static_cast<double>(m_pairs[half_points]) + 0.5;
+      double const x = static_cast<double>(half_points) / 4;
+      n += count;
+      sum += count * x;
+      sum_squares += count * x * x;
+    }
+    double const mean = sum / n;
+    double const variance = sum_squares / n - mean * mean;
+    double const s0 = expected_score(m_config.elo0);
+    double const s1 = expected_score(m_config.elo1);
+    return n * (s1 - s0) * (2 * mean - s0 - s1) / (2 * variance);
+  }
+
+  [[nodiscard]] double lower_bound() const {
+    return std::log(m_config.beta / (1 - m_config.alpha));
+  }
+
+  [[nodiscard]] double upper_bound() const {
+    return std::log((1 - m_config.beta) / m_config.alpha);
+  }
+
+  [[nodiscard]] SprtResult result() const {
+    double const ratio = llr();
+    if (ratio >= upper_bound()) {
+      return SprtResult::ACCEPT_H1;
+    }
+    if (ratio <= lower_bound()) {
+      return SprtResult::ACCEPT_H0;
+    }
+    return SprtResult::CONTINUE;
+  }
+};
+
+#endif // SPRT_H
@@ -0,0 +1,103 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool {
+private:
+  std::mutex m_mtx;
+  std::condition_variable m_cv;
+  std::deque<std::move_only_function<void()>> m_tasks;
+  bool m_stop{};
+  std::vector<std::jthread> m_workers;
+
+  void work() {
+    while (true) {
+      std::move_only_function<void()> task;
+      {
+        std::unique_lock lock(m_mtx);
+        m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+        if (m_tasks.empty()) {
+          return;
+        }
+        task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+public:
+  explicit ThreadPool(std::size_t num_threads = default_num_threads()) {
+    m_workers.reserve(std::max<std::size_t>(num_threads, 1));
+    for (std::size_t idx = 0; idx < m_workers.capacity(); ++idx) {
+      m_workers.emplace_back([this]() { work(); });
+    }
+  }
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ThreadPool &operator=(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+  ~ThreadPool() {
+    {
+      std::scoped_lock sl(m_mtx);
+      m_stop = true;
+    }
+    m_cv.notify_all();
+  }
+
+  [[nodiscard]] static std::size_t default_num_threads() {
+    return std::max(std::thread::hardware_concurrency(), 1U);
+  }
+
+  [[nodiscard]] std::size_t num_threads() const {
+    return m_workers.size();
+  }
+
+  template <typename Func>
+  auto submit(Func &&func) -> std::future<std::invoke_result_t<Func>> {
+    std::packaged_task<std::invoke_result_t<Func>()> task(
+        std::forward<Func>(func));
+    auto future = task.get_future();
+    {
+      std::scoped_lock sl(m_mtx);
+      m_tasks.emplace_back(std::move(task));
+    }
+    m_cv.notify_one();
+    return future;
+  }
+
+  // calls func(idx) for every idx in [0, count), spread over all the
+  // workers; it returns when all the calls are done and rethrows the first
+  // exception thrown by any of them
+  template <typename Func>
+  void parallel_for(std::size_t count, Func const &func) {
+    std::atomic<std::size_t> next{0};
+    std::vector<std::future<void>> futures;
+    for (std::size_t worker = 0; worker < std::min(count, num_threads());
+         ++worker) {
+      futures.emplace_back(submit([&next, count, &func]() {
+        for (std::size_t idx = next++; idx < count; idx = next++) {
+          func(idx);
+        }
+      }));
+    }
+    for (auto &future : futures) {
+      future.wait();
+    }
+    for (auto &future : futures) {
+      future.get();
+    }
+  }
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,207 @@
+#ifndef TIMED_PLAYER_H
+#define TIMED_PLAYER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+#include "FPlayer.h"
+#include "FPlayerLinear.h"
+#include "FacilityGame.h"
+
+// the overruns of a player under time control, in one game
+struct TimeControlStats {
+  // the number of calls which did not return in time; after the first one
+  // the player is out of the game, so it is 0 or 1
+  std::size_t overruns{};
+  // the moves played by the fallback instead of the player
+  std::size_t fallback_moves{};
+};
+
+// Plays a player under time control: every initialize and next_move call
+// runs on a worker thread of the player, and must return within the time
+// limit. The worker keeps its own copy of the game, copied by initialize and
+// brought up to date with the moves played since the last call, so the
+// player never reads the game of the caller. A player which runs late is
+// abandoned: it is asked to stop with FPlayer::request_stop, the rest of the
+// game is played for it by the FPlayerLinear rule, the first free node, and
+// its worker finishes the call in the background and is joined when the
+// TimedPlayer is destroyed, at the end of the game.
+class TimedPlayer {
+private:
+  // what the game thread and the worker share
+  struct Shared {
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::unique_ptr<FPlayer> player;
+    // only used by the worker
+    std::optional<FacilityGame> game;
+
+    // the request: a new game, or the moves since the last request
+    std::optional<FacilityGame> new_game;
+    std::vector<std::size_t> new_moves;
+    bool initialize{};
+    bool pending{};
+    bool stop{};
+
+    // the reply
+    bool done{};
+    std::size_t move{};
+    std::exception_ptr error;
+  };
+
+  std::shared_ptr<Shared> m_shared;
+  std::thread m_worker;
+  std::chrono::nanoseconds m_limit;
+  FPlayerLinear m_fallback;
+  // the moves of the game the worker already has
+  std::size_t m_num_synced{};
+  bool m_abandoned{};
+  TimeControlStats m_stats;
+
+  static void work(std::shared_ptr<Shared> const &shared) {
+    Shared &s = *shared;
+    std::optional<FacilityGame> new_game;
+    std::vector<std::size_t> new_moves;
+    std::unique_lock lock(s.mtx);
+    while (true) {
+      s.cv.wait(lock, [&s]() { return s.stop || s.pending; });
+      if (s.stop) {
+        return;
+      }
+      s.pending = false;
+      new_game.swap(s.new_game);
+      new_moves.swap(s.new_moves);
+      bool const initialize = s.initialize;
+      lock.unlock();
+
+      std::size_t move{};
+      std::exception_ptr error;
+      try {
+        if (new_game) {
+          s.game = std::move(new_game);
+          new_game.reset();
+        }
+        for (std::size_t idx : new_moves) {
+          s.game->append_move(s.game->get_player_to_move(), idx);
+        }
+        new_moves.clear();
+        if (initialize) {
+          s.player->initialize(*s.game);
+        } else {
+          move = s.player->next_move(*s.game);
+        }
+      } catch (...) {
+        error = std::current_exception();
+      }
+
+      lock.lock();
+      s.move = move;
+      s.error = error;
+      s.done = true;
+      s.cv.notify_all();
+    }
+  }
+
+  // sends the request, which the caller has filled in under the lock, and
+  // waits for the reply until the time limit; false if the player ran late
+  bool call(std::unique_lock<std::mutex> &lock) {
+    Shared &s = *m_shared;
+    s.pending = true;
+    s.done = false;
+    s.cv.notify_all();
+    if (!s.cv.wait_for(lock, m_limit, [&s]() { return s.done; })) {
+      return false;
+    }
+    if (s.error) {
+      std::rethrow_exception(s.error);
+    }
+    return true;
+  }
+
+  void abandon() {
+    ++m_stats.overruns;
+    m_abandoned = true;
+    // the player is still running its call on the worker, and request_stop
+    // is safe to call meanwhile
+    m_shared->player->request_stop();
+    {
+      std::scoped_lock sl(m_shared->mtx);
+      m_shared->stop = true;
+    }
+    m_shared->cv.notify_all();
+  }
+
+public:
+  TimedPlayer(
+      std::unique_ptr<FPlayer> player,
+      Player seat,
+      std::chrono::nanoseconds limit)
+      : m_shared(std::make_shared<Shared>()),
+        m_limit(limit),
+        m_fallback(seat) {
+    m_shared->player = std::move(player);
+    m_worker = std::thread([shared = m_shared]() { work(shared); });
+  }
+
+  TimedPlayer(TimedPlayer const &) = delete;
+  TimedPlayer(TimedPlayer &&) = delete;
+  TimedPlayer &operator=(TimedPlayer const &) = delete;
+  TimedPlayer &operator=(TimedPlayer &&) = delete;
+
+  ~TimedPlayer() {
+    if (m_worker.joinable()) {
+      {
+        std::scoped_lock sl(m_shared->mtx);
+        m_shared->stop = true;
+      }
+      m_shared->cv.notify_all();
+      m_worker.join();
+    }
+  }
+
+  void initialize(FacilityGame const &game) {
+    m_num_synced = game.get_moves().size();
+    if (m_abandoned) {
+      return;
+    }
+    std::unique_lock lock(m_shared->mtx);
+    m_shared->new_game.emplace(game);
+    m_shared->new_moves.clear();
+    m_shared->initialize = true;
+    if (!call(lock)) {
+      lock.unlock();
+      abandon();
+    }
+  }
+
+  std::size_t next_move(FacilityGame const &game) {
+    if (!m_abandoned) {
+      auto const &moves = game.get_moves();
+      std::unique_lock lock(m_shared->mtx);
+      m_shared->new_moves.assign(
+          moves.begin() + static_cast<std::ptrdiff_t>(m_num_synced),
+          moves.end());
+      m_shared->initialize = false;
+      m_num_synced = moves.size();
+      if (call(lock)) {
+        return m_shared->move;
+      }
+      lock.unlock();
+      abandon();
+    }
+    ++m_stats.fallback_moves;
+    return m_fallback.next_move(game);
+  }
+
+  [[nodiscard]] TimeControlStats const &get_stats() const {
+    return m_stats;
+  }
+};
+
+#endif // TIMED_PLAYER_H
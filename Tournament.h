@@ -0,0 +1,332 @@
+#ifndef TOURNAMENT_H
+#define TOURNAMENT_H
+
+#include <chrono>
+#include <fmt/core.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BookPlayer.h"
+#include "FacilityGame.h"
+#include "LatencyStats.h"
+#include "Match.h"
+#include "MonitorThread.h"
+#include "MoveLogWriter.h"
+#include "OpeningBook.h"
+#include "PlayerRegistry.h"
+#include "ThreadPool.h"
+#include "TimedPlayer.h"
+
+struct TournamentConfig {
+  std::vector<std::string> players;
+  std::vector<std::size_t> sizes;
+  std::vector<std::size_t> seeds;
+  std::size_t num_threads{ThreadPool::default_num_threads()};
+  bool verbose{};
+  // the move log the games are appended to, if not empty
+  std::string log;
+  // the JSON file the think times of the players are written to, if not
+  // empty
+  std::string latency;
+  // the time limit of every initialize and next_move call, none if zero
+  std::chrono::milliseconds move_time{};
+  // the opening book every player plays from, if not empty
+  std::string book;
+};
+
+struct MatchResult {
+  std::size_t player_a{};
+  std::size_t player_b{};
+  std::size_t size{};
+  std::size_t seed{};
+  std::size_t score_a{};
+  std::size_t score_b{};
+  TimeControlStats time_a{};
+  TimeControlStats time_b{};
+};
+
+// A player of a tournament match, which reports its calls to the match's
+// monitor slot: STARTING while it initializes, WAITING_FOR_ME while it
+// chooses a move and WAITING_FOR_OPPONENT otherwise. The round is the number
+// of moves PLAYER_A has played.
+template <GamePlayer P>
+class MonitoredPlayer {
+private:
+  P &m_player;
+  MonitorThread::Game const &m_watch;
+
+  [[nodiscard]] static int round(FacilityGame const &game) {
+    return static_cast<int>((game.get_moves().size() + 1) / 2);
+  }
+
+public:
+  MonitoredPlayer(P &player, MonitorThread::Game const &watch)
+      : m_player(player),
+        m_watch(watch) {}
+
+  void initialize(FacilityGame const &game) {
+    m_watch.set_state(round(game), PlayerState::STARTING);
+    m_player.initialize(game);
+    m_watch.set_state(round(game), PlayerState::WAITING_FOR_OPPONENT);
+  }
+
+  std::size_t next_move(FacilityGame const &game) {
+    m_watch.set_state(round(game), PlayerState::WAITING_FOR_ME);
+    std::size_t const move = m_player.next_move(game);
+    m_watch.set_state(round(game), PlayerState::WAITING_FOR_OPPONENT);
+    return move;
+  }
+};
+
+// Every player plays every other player in both seat orders, on every board
+// size and seed. The matches are independent, so they run on a thread pool;
+// each one writes only its own slot in the results, and the report is built
+// from the results in match order, so the output does not depend on the
+// number of threads. A MonitorThread watches the running matches, one slot
+// per worker thread, and warns about a player which has not returned for a
+// while.
+class Tournament {
+private:
+  struct Standing {
+    std::size_t wins{};
+    std::size_t draws{};
+    std::size_t losses{};
+    std::size_t points_for{};
+    std::size_t points_against{};
+    std::size_t overruns{};
+    std::size_t fallback_moves{};
+  };
+
+  TournamentConfig m_config;
+  std::vector<PlayerEntry const *> m_players;
+  std::vector<MatchResult> m_results;
+  std::unique_ptr<MoveLogWriter> m_log;
+  std::unique_ptr<LatencyStats> m_latency;
+  std::shared_ptr<OpeningBook const> m_book;
+  std::unique_ptr<MonitorThread> m_monitor;
+
+  [[nodiscard]] std::vector<MatchResult> schedule() const {
+    std::vector<MatchResult> matches;
+    for (std::size_t size : m_config.sizes) {
+      for (std::size_t seed : m_config.seeds) {
+        for (std::size_t a = 0; a < m_players.size(); ++a) {
+          for (std::size_t b = 0; b < m_players.size(); ++b) {
+            if (a != b) {
+              matches.push_back({a, b, size, seed, 0, 0});
+            }
+          }
+        }
+      }
+    }
+    return matches;
+  }
+
+  template <GamePlayer PlayerA, GamePlayer PlayerB>
+  void play(
+      MatchResult const &match,
+      FacilityGame &game,
+      PlayerA &player_a,
+      PlayerB &player_b) const {
+    if (!m_log && !m_latency) {
+      play_game(game, player_a, player_b);
+    } else {
+      GameRecord record{
+          .size = match.size,
+          .seed = match.seed,
+          .player_a = m_players[match.player_a]->name,
+          .player_b = m_players[match.player_b]->name};
+      play_game(
+          game,
+          player_a,
+          player_b,
+          MoveTimer(
+              game,
+              m_latency ? &m_latency->get(match.player_a) : nullptr,
+              m_latency ? &m_latency->get(match.player_b) : nullptr,
+              m_log ? &record.times : nullptr));
+      if (m_log) {
+        record.moves = game.get_moves();
+        m_log->record(record);
+      }
+    }
+  }
+
+  void play(MatchResult &match) const {
+    FacilityGame game(match.size, match.seed);
+    auto player_a = m_players[match.player_a]->create(Player::PLAYER_A);
+    auto player_b = m_players[match.player_b]->create(Player::PLAYER_B);
+    if (m_book) {
+      player_a = std::make_unique<BookPlayer>(
+          std::move(player_a),
+          Player::PLAYER_A,
+          m_book);
+      player_b = std::make_unique<BookPlayer>(
+          std::move(player_b),
+          Player::PLAYER_B,
+          m_book);
+    }
+    auto const watch = m_monitor->watch();
+    if (m_config.move_time == std::chrono::milliseconds::zero()) {
+      MonitoredPlayer<FPlayer> monitored_a(*player_a, watch);
+      MonitoredPlayer<FPlayer> monitored_b(*player_b, watch);
+      play(match, game, monitored_a, monitored_b);
+    } else {
+      TimedPlayer timed_a(
+          std::move(player_a),
+          Player::PLAYER_A,
+          m_config.move_time);
+      TimedPlayer timed_b(
+          std::move(player_b),
+          Player::PLAYER_B,
+          m_config.move_time);
+      MonitoredPlayer<TimedPlayer> monitored_a(timed_a, watch);
+      MonitoredPlayer<TimedPlayer> monitored_b(timed_b, watch);
+      play(match, game, monitored_a, monitored_b);
+      match.time_a = timed_a.get_stats();
+      match.time_b = timed_b.get_stats();
+    }
+    match.score_a = game.get_score(Player::PLAYER_A);
+    match.score_b = game.get_score(Player::PLAYER_B);
+  }
+
+public:
+  explicit Tournament(TournamentConfig config) : m_config(std::move(config)) {
+    for (auto const &name : m_config.players) {
+      m_players.push_back(&find_player(
+          name,
+          m_config.move_time != std::chrono::milliseconds::zero()));
+    }
+    if (m_players.size() < 2) {
+      throw FacilityGameException("A tournament needs at least two players");
+    }
+    if (!m_config.book.empty()) {
+      m_book = std::make_shared<OpeningBook const>(
+          OpeningBook::load(m_config.book));
+    }
+  }
+
+  void run() {
+    m_results = schedule();
+    if (!m_config.log.empty()) {
+      m_log = std::make_unique<MoveLogWriter>(m_config.log);
+    }
+    if (!m_config.latency.empty()) {
+      m_latency = std::make_unique<LatencyStats>(m_config.players);
+    }
+
+    auto const start = std::chrono::steady_clock::now();
+    std::size_t num_threads{};
+    {
+      ThreadPool pool(m_config.num_threads);
+      num_threads = pool.num_threads();
+      // one slot per worker, so it follows the clamping of the pool
+      m_monitor = std::make_unique<MonitorThread>(num_threads);
+      pool.parallel_for(m_results.size(), [this](std::size_t idx) {
+        play(m_results[idx]);
+      });
+    }
+    std::chrono::duration<double> const elapsed =
+        std::chrono::steady_clock::now() - start;
+    m_monitor.reset();
+    if (m_log) {
+      m_log->close();
+      m_log.reset();
+    }
+
+    fmt::println(
+        "{} games in {:.3f} sec ({:.1f} games/sec) on {} threads",
+        m_results.size(),
+        elapsed.count(),
+        static_cast<double>(m_results.size()) / elapsed.count(),
+        num_threads);
+  }
+
+  [[nodiscard]] std::vector<MatchResult> const &get_results() const {
+    return m_results;
+  }
+
+  void print() const {
+    if (m_config.verbose) {
+      for (auto const &match : m_results) {
+        fmt::println(
+            "size:{} seed:{} {} vs {}: {} - {}",
+            match.size,
+            match.seed,
+            m_players[match.player_a]->name,
+            m_players[match.player_b]->name,
+            match.score_a,
+            match.score_b);
+      }
+    }
+
+    std::vector<Standing> standings(m_players.size());
+    for (auto const &match : m_results) {
+      auto &a = standings[match.player_a];
+      auto &b = standings[match.player_b];
+      a.points_for += match.score_a;
+      a.points_against += match.score_b;
+      b.points_for += match.score_b;
+      b.points_against += match.score_a;
+      a.overruns += match.time_a.overruns;
+      a.fallback_moves += match.time_a.fallback_moves;
+      b.overruns += match.time_b.overruns;
+      b.fallback_moves += match.time_b.fallback_moves;
+      if (match.score_a > match.score_b) {
+        ++a.wins;
+        ++b.losses;
+      } else if (match.score_b > match.score_a) {
+        ++b.wins;
+        ++a.losses;
+      } else {
+        ++a.draws;
+        ++b.draws;
+      }
+    }
+
+    fmt::println(
+        "{:<12} {:>6} {:>6} {:>6} {:>14} {:>14}",
+        "PLAYER",
+        "WINS",
+        "DRAWS",
+        "LOSSES",
+        "POINTS FOR",
+        "POINTS AGAINST");
+    for (std::size_t idx = 0; idx < m_players.size(); ++idx) {
+      auto const &standing = standings[idx];
+      fmt::println(
+          "{:<12} {:>6} {:>6} {:>6} {:>14} {:>14}",
+          m_players[idx]->name,
+          standing.wins,
+          standing.draws,
+          standing.losses,
+          standing.points_for,
+          standing.points_against);
+    }
+
+    if (m_config.move_time != std::chrono::milliseconds::zero()) {
+      fmt::println(
+          "time control: {} ms per call",
+          m_config.move_time.count());
+      fmt::println(
+          "{:<12} {:>9} {:>15}",
+          "PLAYER",
+          "OVERRUNS",
+          "FALLBACK MOVES");
+      for (std::size_t idx = 0; idx < m_players.size(); ++idx) {
+        fmt::println(
+            "{:<12} {:>9} {:>15}",
+            m_players[idx]->name,
+            standings[idx].overruns,
+            standings[idx].fallback_moves);
+      }
+    }
+
+    if (m_latency) {
+      m_latency->print();
+      m_latency->save(m_config.latency);
+    }
+  }
+};
+
+#endif // TOURNAMENT_H
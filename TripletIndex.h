@@ -0,0 +1,203 @@
+#ifndef TRIPLET_INDEX_H
+#define TRIPLET_INDEX_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include "FacilityGame.h"
+
+// The best triplet of FREE nodes which can become a bonus group, over the
+// spacing patterns (i, i+2, i+4), (i, i+2, i+5), (i, i+3, i+5) and
+// (i, i+3, i+6). The best triplet has the largest sum; ties go to the first
+// pattern in that order, then to the smallest i.
+//
+// A segment tree over i holds the best triplet starting at every node, packed
+// into a 16 bit key (sum, pattern) which compares like the order above, so
+// the best triplet is at the root and its position is found by walking down
+// to the leftmost leaf with the same key. A move only changes the statuses of
+// its node and its two neighbors, so only the triplets starting at most 7
+// nodes to its left and 1 to its right are updated.
+//
+// The leaves are built by one fused pass over the FREE masks, which finds the
+// triplets of all the patterns 64 nodes at a time with branch-free code that
+// the compiler vectorizes. On x86-64 the pass is also compiled for AVX2, and
+// the loader picks the build which the CPU supports.
+class TripletIndex {
+public:
+  struct Triplet {
+    std::array<std::size_t, 3> nodes;
+    std::size_t sum;
+  };
+
+private:
+  using key_t = std::uint16_t;
+
+  static constexpr std::array<std::array<std::size_t, 2>, 4> PATTERNS{{
+      {2, 4},
+      {2, 5},
+      {3, 5},
+      {3, 6},
+  }};
+  static constexpr std::size_t MAX_SPAN = 6;
+  static constexpr std::size_t WORD_BITS = PackedStatuses::WORD_BITS;
+  static constexpr std::size_t PATTERN_BITS = 2;
+  static constexpr key_t PATTERN_MASK = (1U << PATTERN_BITS) - 1;
+  static_assert(PATTERNS.size() == 1U << PATTERN_BITS);
+  static_assert(
+      3 * MAX_VALUE << PATTERN_BITS <= std::numeric_limits<key_t>::max());
+
+  std::size_t m_num_nodes{};
+  // the number of leaves, a power of 2; the root is at 1 and the children of
+  // node k are at 2k and 2k+1
+  std::size_t m_num_leaves{};
+  std::vector<key_t> m_tree;
+  // the number of moves of the game already applied
+  std::size_t m_num_moves{};
+
+  // 0 if no triplet starts at idx; the earlier patterns get the larger low
+  // bits, so that they win ties
+  [[nodiscard]] key_t leaf_key(
+      FacilityGame const &game,
+      std::size_t idx) const {
+    auto const &statuses = game.get_statuses();
+    if (statuses[idx] != FacilityStatus::FREE) {
+      return 0;
+    }
+    key_t best{};
+    for (std::size_t pattern = 0; pattern < PATTERNS.size(); ++pattern) {
+      auto const [b, c] = PATTERNS[pattern];
+      if (idx + c >= m_num_nodes || statuses[idx + b] != FacilityStatus::FREE
+          || statuses[idx + c] != FacilityStatus::FREE) {
+        continue;
+      }
+      std::size_t const sum =
+          game.get_node(idx) + game.get_node(idx + b) + game.get_node(idx + c);
+      auto const key = static_cast<key_t>(
+          (sum << PATTERN_BITS) | (PATTERN_MASK - pattern));
+      best = std::max(best, key);
+    }
+    return best;
+  }
+
+  // the keys of the 64 leaves of a word, from the FREE masks of the word and
+  // of the next one, and the values of the word and of the MAX_SPAN nodes
+  // after it
+#if defined(__x86_64__) && defined(__GNUC__)
+  [[gnu::target_clones("avx2", "default")]]
+#endif
+  static void scan_word(
+      FacilityGame::node_t const *values,
+      PackedStatuses::word_t free,
+      PackedStatuses::word_t next_free,
+      key_t *keys) {
+    std::array<key_t, WORD_BITS + MAX_SPAN> is_free{};
+    for (std::size_t idx = 0; idx < WORD_BITS; ++idx) {
+      is_free[idx] = static_cast<key_t>((free >> idx) & 1U);
+    }
+    for (std::size_t idx = 0; idx < MAX_SPAN; ++idx) {
+      is_free[WORD_BITS + idx] = static_cast<key_t>((next_free >> idx) & 1U);
+    }
+    for (std::size_t idx = 0; idx < WORD_BITS; ++idx) {
+      key_t best{};
+      for (std::size_t pattern = 0; pattern < PATTERNS.size(); ++pattern) {
+        auto const [b, c] = PATTERNS[pattern];
+        auto const sum = static_cast<key_t>(
+            values[idx] + values[idx + b] + values[idx + c]);
+        auto const key = static_cast<key_t>(
+            ((sum << PATTERN_BITS) | (PATTERN_MASK - pattern)) * is_free[idx]
+            * is_free[idx + b] * is_free[idx + c]);
+        best = std::max(best, key);
+      }
+      keys[idx] = best;
+    }
+  }
+
+  void build_inner_nodes() {
+    for (std::size_t node = m_num_leaves - 1; node >= 1; --node) {
+      m_tree[node] = std::max(m_tree[2 * node], m_tree[2 * node + 1]);
+    }
+  }
+
+  void update_leaf(FacilityGame const &game, std::size_t idx) {
+    std::size_t node = m_num_leaves + idx;
+    m_tree[node] = leaf_key(game, idx);
+    for (node /= 2; node >= 1; node /= 2) {
+      m_tree[node] = std::max(m_tree[2 * node], m_tree[2 * node + 1]);
+    }
+  }
+
+public:
+  void assign(FacilityGame const &game) {
+    m_num_nodes = game.get_num_nodes();
+    m_num_leaves = std::bit_ceil(std::max<std::size_t>(m_num_nodes, 1));
+    m_tree.assign(2 * m_num_leaves, 0);
+    // the words whose triplets may end past the board are done leaf by leaf
+    auto const &statuses = game.get_statuses();
+    std::size_t const num_words =
+        m_num_nodes >= MAX_SPAN ? (m_num_nodes - MAX_SPAN) / WORD_BITS : 0;
+    for (std::size_t word = 0; word < num_words; ++word) {
+      scan_word(
+          game.get_nodes().data() + word * WORD_BITS,
+          statuses.free_mask(word),
+          statuses.free_mask(word + 1),
+          m_tree.data() + m_num_leaves + word * WORD_BITS);
+    }
+    for (std::size_t idx = num_words * WORD_BITS; idx < m_num_nodes; ++idx) {
+      m_tree[m_num_leaves + idx] = leaf_key(game, idx);
+    }
+    build_inner_nodes();
+    m_num_moves = game.get_moves().size();
+  }
+
+  // the same as assign, leaf by leaf, e.g. to compare against it
+  void assign_scalar(FacilityGame const &game) {
+    m_num_nodes = game.get_num_nodes();
+    m_num_leaves = std::bit_ceil(std::max<std::size_t>(m_num_nodes, 1));
+    m_tree.assign(2 * m_num_leaves, 0);
+    for (std::size_t idx = 0; idx < m_num_nodes; ++idx) {
+      m_tree[m_num_leaves + idx] = leaf_key(game, idx);
+    }
+    build_inner_nodes();
+    m_num_moves = game.get_moves().size();
+  }
+
+  // applies the moves played since the last assign or update
+  void update(FacilityGame const &game) {
+    auto const &moves = game.get_moves();
+    if (moves.size() < m_num_moves) {
+      assign(game);
+      return;
+    }
+    for (; m_num_moves < moves.size(); ++m_num_moves) {
+      std::size_t const move = moves[m_num_moves];
+      std::size_t const first = move >= MAX_SPAN + 1 ? move - MAX_SPAN - 1 : 0;
+      std::size_t const last = std::min(move + 1, m_num_nodes - 1);
+      for (std::size_t idx = first; idx <= last; ++idx) {
+        update_leaf(game, idx);
+      }
+    }
+  }
+
+  [[nodiscard]] std::optional<Triplet> best(FacilityGame const &game) const {
+    key_t const key = m_tree[1];
+    if (key == 0) {
+      return std::nullopt;
+    }
+    std::size_t node = 1;
+    while (node < m_num_leaves) {
+      node = m_tree[2 * node] == key ? 2 * node : 2 * node + 1;
+    }
+    std::size_t const idx = node - m_num_leaves;
+    auto const [b, c] = PATTERNS[PATTERN_MASK - (key & PATTERN_MASK)];
+    return Triplet{
+        {idx, idx + b, idx + c},
+        game.get_node(idx) + game.get_node(idx + b) + game.get_node(idx + c)};
+  }
+};
+
+#endif // TRIPLET_INDEX_H
@@ -0,0 +1,485 @@
+#include "FacilityGame.h"
+#include "CommandLine.h"
+#include "FPlayerHighest.h"
+#include "FPlayerLinear.h"
+#include "FacilityGameException.h"
+#include "Match.h"
+#include "MoveLog.h"
+#include "PlayerRegistry.h"
+#include "ScoreReduction.h"
+#include "TripletIndex.h"
+#include "enums.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <new>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// every allocation of the process is counted, so that the benchmarks can
+// report the allocations of the code they measure
+namespace {
+std::atomic<std::size_t> num_allocs;
+std::atomic<std::size_t> num_alloc_bytes;
+} // namespace
+
+// none of the replacements is inlined, since GCC would see malloc() and
+// free() in their callers and warn about a new/delete mismatch there
+[[gnu::noinline]] void *operator new(std::size_t size) {
+  num_allocs.fetch_add(1, std::memory_order_relaxed);
+  num_alloc_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *ptr = std::malloc(size == 0 ? 1 : size)) {
+    return ptr;
+  }
+  throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void *ptr) noexcept {
+  std::free(ptr);
+}
+
+[[gnu::noinline]] void operator delete(
+    void *ptr,
+    [[maybe_unused]] std::size_t size) noexcept {
+  std::free(ptr);
+}
+
+namespace {
+
+constexpr char const *USAGE = R"(usage:
+  facility_bench [--format csv|json] [--min-size N] [--max-size N]
+                 [--min-time MS] [--seed N] [--filter TEXT])";
+
+using clock_t = std::chrono::steady_clock;
+
+// keeps the compiler from optimizing away a value or the reads and writes of
+// an object
+template <typename T>
+void do_not_optimize(T const &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchConfig {
+  bool json{};
+  std::size_t min_size{100};
+  std::size_t max_size{10000000};
+  std::chrono::milliseconds min_time{200};
+  std::size_t seed{3};
+  std::string filter;
+};
+
+struct BenchResult {
+  std::string name;
+  std::size_t size{};
+  std::size_t ops{};
+  // the board nodes processed per operation, for the throughput
+  std::size_t nodes_per_op{};
+  std::chrono::nanoseconds time{};
+  std::size_t allocs{};
+  std::size_t alloc_bytes{};
+
+  [[nodiscard]] double ns_per_op() const {
+    return static_cast<double>(time.count()) / static_cast<double>(ops);
+  }
+
+  [[nodiscard]] double ops_per_sec() const {
+    return static_cast<double>(ops)
+           / std::chrono::duration<double>(time).count();
+  }
+
+  [[nodiscard]] double nodes_per_sec() const {
+    return ops_per_sec() * static_cast<double>(nodes_per_op);
+  }
+
+  [[nodiscard]] double allocs_per_op() const {
+    return static_cast<double>(allocs) / static_cast<double>(ops);
+  }
+
+  [[nodiscard]] double bytes_per_op() const {
+    return static_cast<double>(alloc_bytes) / static_cast<double>(ops);
+  }
+};
+
+// accumulates the time and the allocations between start() and stop(), so
+// that a benchmark can leave its setup out of the measurement
+class Stopwatch {
+private:
+  BenchResult &m_result;
+  clock_t::time_point m_start;
+  std::size_t m_allocs{};
+  std::size_t m_alloc_bytes{};
+
+public:
+  explicit Stopwatch(BenchResult &result) : m_result(result) {}
+
+  void start() {
+    m_allocs = num_allocs.load(std::memory_order_relaxed);
+    m_alloc_bytes = num_alloc_bytes.load(std::memory_order_relaxed);
+    m_start = clock_t::now();
+  }
+
+  void stop(std::size_t ops) {
+    m_result.time += clock_t::now() - m_start;
+    m_result.allocs += num_allocs.load(std::memory_order_relaxed) - m_allocs;
+    m_result.alloc_bytes +=
+        num_alloc_bytes.load(std::memory_order_relaxed) - m_alloc_bytes;
+    m_result.ops += ops;
+  }
+
+  [[nodiscard]] std::chrono::nanoseconds elapsed() const {
+    return m_result.time;
+  }
+};
+
+class Bench {
+private:
+  BenchConfig m_config;
+  std::vector<BenchResult> m_results;
+
+public:
+  explicit Bench(BenchConfig config) : m_config(std::move(config)) {}
+
+  [[nodiscard]] BenchConfig const &get_config() const {
+    return m_config;
+  }
+
+  // calls body(stopwatch) until min_time has been measured, at least once
+  template <typename Body>
+  void run(
+      std::string name,
+      std::size_t size,
+      std::size_t nodes_per_op,
+      Body body) {
+    if (name.find(m_config.filter) == std::string::npos) {
+      return;
+    }
+    BenchResult result{
+        .name = std::move(name),
+        .size = size,
+        .nodes_per_op = nodes_per_op};
+    Stopwatch stopwatch(result);
+    do {
+      body(stopwatch);
+    } while (stopwatch.elapsed() < m_config.min_time);
+    fmt::println(
+        stderr,
+        "{:<24} {:>9} {:>14.1f} ns/op",
+        result.name,
+        result.size,
+        result.ns_per_op());
+    m_results.push_back(std::move(result));
+  }
+
+  void print() const {
+    if (m_config.json) {
+      fmt::println("[");
+      for (std::size_t idx = 0; idx < m_results.size(); ++idx) {
+        auto const &result = m_results[idx];
+        fmt::println(
+            R"(  {{"benchmark": "{}", "size": {}, "ops": {}, )"
+            R"("ns_per_op": {:.3f}, "ops_per_sec": {:.1f}, )"
+            R"("nodes_per_sec": {:.1f}, "allocs_per_op": {:.3f}, )"
+            R"("bytes_per_op": {:.1f}}}{})",
+            result.name,
+            result.size,
+            result.ops,
+            result.ns_per_op(),
+            result.ops_per_sec(),
+            result.nodes_per_sec(),
+            result.allocs_per_op(),
+            result.bytes_per_op(),
+            idx + 1 < m_results.size() ? "," : "");
+      }
+      fmt::println("]");
+      return;
+    }
+    fmt::println(
+        "benchmark,size,ops,ns_per_op,ops_per_sec,nodes_per_sec,"
+        "allocs_per_op,bytes_per_op");
+    for (auto const &result : m_results) {
+      fmt::println(
+          "{},{},{},{:.3f},{:.1f},{:.1f},{:.3f},{:.1f}",
+          result.name,
+          result.size,
+          result.ops,
+          result.ns_per_op(),
+          result.ops_per_sec(),
+          result.nodes_per_sec(),
+          result.allocs_per_op(),
+          result.bytes_per_op());
+    }
+  }
+};
+
+// the moves of a game where both players pick uniformly random free nodes
+std::vector<std::size_t> random_moves(FacilityGame game, std::size_t seed) {
+  game.clear();
+  std::vector<std::size_t> order(game.get_num_nodes());
+  for (std::size_t idx = 0; idx < order.size(); ++idx) {
+    order[idx] = idx;
+  }
+  std::mt19937 gen(seed);
+  std::ranges::shuffle(order, gen);
+  for (std::size_t idx : order) {
+    if (game.get_status(idx) == FacilityStatus::FREE) {
+      game.append_move(game.get_player_to_move(), idx);
+    }
+  }
+  return game.get_moves();
+}
+
+void bench_game(Bench &bench, std::size_t size) {
+  std::size_t const seed = bench.get_config().seed;
+
+  bench.run("construct", size, size, [&](Stopwatch &stopwatch) {
+    stopwatch.start();
+    FacilityGame game(size, seed);
+    do_not_optimize(game);
+    stopwatch.stop(1);
+  });
+
+  FacilityGame game(size, seed);
+  auto const moves = random_moves(game, seed);
+
+  bench.run("append_move", size, 1, [&](Stopwatch &stopwatch) {
+    game.clear();
+    stopwatch.start();
+    for (std::size_t idx : moves) {
+      game.append_move(game.get_player_to_move(), idx);
+    }
+    do_not_optimize(game);
+    stopwatch.stop(moves.size());
+  });
+
+  GameRecord record{.size = size, .seed = seed, .moves = moves};
+  std::vector<unsigned char> encoded;
+
+  bench.run("log_encode", size, 1, [&](Stopwatch &stopwatch) {
+    encoded.clear();
+    stopwatch.start();
+    record.encode(encoded);
+    do_not_optimize(encoded);
+    stopwatch.stop(moves.size());
+  });
+
+  // decodes the record without its byte length and replays it
+  bench.run("log_replay", size, 1, [&](Stopwatch &stopwatch) {
+    move_log::Decoder in(encoded);
+    auto const body = in.bytes(in.varint());
+    GameRecord decoded;
+    game.clear();
+    stopwatch.start();
+    decoded.decode(body);
+    decoded.replay(game);
+    do_not_optimize(game);
+    stopwatch.stop(moves.size());
+  });
+
+  // the rest runs on a board in the middle of the game
+  game.clear();
+  for (std::size_t idx = 0; idx < moves.size() / 2; ++idx) {
+    game.append_move(game.get_player_to_move(), moves[idx]);
+  }
+
+  bench.run("is_finished", size, 1, [&](Stopwatch &stopwatch) {
+    constexpr std::size_t BATCH = 1 << 20;
+    stopwatch.start();
+    for (std::size_t idx = 0; idx < BATCH; ++idx) {
+      do_not_optimize(game);
+      bool const finished = game.is_finished();
+      do_not_optimize(finished);
+    }
+    stopwatch.stop(BATCH);
+  });
+
+  bench.run("compute_score", size, size, [&](Stopwatch &stopwatch) {
+    stopwatch.start();
+    std::size_t const score = game.compute_score(Player::PLAYER_A);
+    do_not_optimize(score);
+    stopwatch.stop(1);
+  });
+
+  bench.run("compute_scores", size, size, [&](Stopwatch &stopwatch) {
+    stopwatch.start();
+    auto const scores = compute_scores(game);
+    do_not_optimize(scores);
+    stopwatch.stop(1);
+  });
+
+  // NightHawk's triplet index, built by the fused scan and leaf by leaf
+  TripletIndex triplets;
+
+  bench.run("triplet_scan", size, size, [&](Stopwatch &stopwatch) {
+    stopwatch.start();
+    triplets.assign(game);
+    do_not_optimize(triplets);
+    stopwatch.stop(1);
+  });
+
+  bench.run("triplet_scan_scalar", size, size, [&](Stopwatch &stopwatch) {
+    stopwatch.start();
+    triplets.assign_scalar(game);
+    do_not_optimize(triplets);
+    stopwatch.stop(1);
+  });
+
+  bench.run("score_calculation", size, size, [&](Stopwatch &stopwatch) {
+    stopwatch.start();
+    std::string const detailed = game.score_calculation(Player::PLAYER_A);
+    do_not_optimize(detailed);
+    stopwatch.stop(1);
+  });
+}
+
+// the search players spend a fixed budget per move, which grows with the
+// board, so they are only measured up to a size where a move is quick
+std::size_t max_player_size(std::string_view name) {
+  if (name == "AlphaBeta") {
+    return 1000;
+  }
+  if (name == "MCTS") {
+    return 10000;
+  }
+  return std::numeric_limits<std::size_t>::max();
+}
+
+void bench_player(Bench &bench, PlayerEntry const &entry, std::size_t size) {
+  if (size > max_player_size(entry.name)) {
+    return;
+  }
+  FacilityGame game(size, bench.get_config().seed);
+
+  bench.run(entry.name + "/initialize", size, size, [&](Stopwatch &stopwatch) {
+    auto player = entry.create(Player::PLAYER_A);
+    stopwatch.start();
+    player->initialize(game);
+    stopwatch.stop(1);
+  });
+
+  // the player plays against itself, and the moves are measured in batches,
+  // so they include append_move, which is measured on its own; the game
+  // stops early on large boards once min_time has been measured
+  bench.run(entry.name + "/next_move", size, 1, [&](Stopwatch &stopwatch) {
+    constexpr std::size_t BATCH = 16;
+    game.clear();
+    auto player_a = entry.create(Player::PLAYER_A);
+    auto player_b = entry.create(Player::PLAYER_B);
+    player_a->initialize(game);
+    player_b->initialize(game);
+    auto const start = stopwatch.elapsed();
+    while (!game.is_finished()
+           && stopwatch.elapsed() - start < bench.get_config().min_time) {
+      std::size_t num_moves = 0;
+      stopwatch.start();
+      for (; num_moves < BATCH && !game.is_finished(); ++num_moves) {
+        FPlayer &player = game.get_player_to_move() == Player::PLAYER_A
+                              ? *player_a
+                              : *player_b;
+        game.append_move(game.get_player_to_move(), player.next_move(game));
+      }
+      stopwatch.stop(num_moves);
+    }
+  });
+}
+
+// whole games of Linear against Highest, once with the players known at
+// compile time through play_match, and once through FPlayer references as the
+// players selected at runtime are; both include creating the players
+void bench_match(Bench &bench, std::size_t size) {
+  // a game takes more than a second on larger boards
+  constexpr std::size_t MAX_MATCH_SIZE = 100000;
+  if (size > MAX_MATCH_SIZE) {
+    return;
+  }
+  FacilityGame game(size, bench.get_config().seed);
+  // the first game grows the move and undo stacks of the board
+  play_match<FPlayerLinear, FPlayerHighest>(game);
+
+  bench.run("match/typed", size, size, [&](Stopwatch &stopwatch) {
+    game.clear();
+    stopwatch.start();
+    play_match<FPlayerLinear, FPlayerHighest>(game);
+    do_not_optimize(game);
+    stopwatch.stop(1);
+  });
+
+  bench.run("match/virtual", size, size, [&](Stopwatch &stopwatch) {
+    game.clear();
+    stopwatch.start();
+    std::unique_ptr<FPlayer> player_a =
+        std::make_unique<FPlayerLinear>(Player::PLAYER_A);
+    std::unique_ptr<FPlayer> player_b =
+        std::make_unique<FPlayerHighest>(Player::PLAYER_B);
+    play_game(game, *player_a, *player_b);
+    do_not_optimize(game);
+    stopwatch.stop(1);
+  });
+}
+
+BenchConfig parse_config(std::span<char const *const> args) {
+  BenchConfig config;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--format") {
+      std::string_view const format = option_value(args, idx);
+      if (format != "csv" && format != "json") {
+        throw FacilityGameException(
+            ("Unknown format: " + std::string(format)).c_str());
+      }
+      config.json = format == "json";
+    } else if (arg == "--min-size") {
+      config.min_size = parse_number(option_value(args, idx));
+    } else if (arg == "--max-size") {
+      config.max_size = parse_number(option_value(args, idx));
+    } else if (arg == "--min-time") {
+      config.min_time =
+          std::chrono::milliseconds(parse_number(option_value(args, idx)));
+    } else if (arg == "--seed") {
+      config.seed = parse_number(option_value(args, idx));
+    } else if (arg == "--filter") {
+      config.filter = option_value(args, idx);
+    } else {
+      unknown_option(arg);
+    }
+  }
+  if (config.min_size == 0) {
+    throw FacilityGameException("The minimum size must be at least 1");
+  }
+  return config;
+}
+
+} // namespace
+
+// Micro-benchmarks of the game engine and of the players, on board sizes
+// growing by a factor of 10 from min-size to max-size. The results go to
+// stdout as CSV or JSON, to compare them across commits; the progress goes to
+// stderr.
+int main(int argc, char const *const *argv) {
+  std::span<char const *const> args(
+      argv + 1,
+      static_cast<std::size_t>(argc - 1));
+  try {
+    Bench bench(parse_config(args));
+    for (std::size_t size = bench.get_config().min_size;
+         size <= bench.get_config().max_size;
+         size *= 10) {
+      bench_game(bench, size);
+      bench_match(bench, size);
+      for (auto const &entry : registered_players()) {
+        bench_player(bench, entry, size);
+      }
+    }
+    bench.print();
+    return 0;
+  } catch (FacilityGameException const &ex) {
+    fmt::println(stderr, "{}\n{}", ex.what(), USAGE);
+    return 1;
+  }
+}
@@ -1,80 +1,898 @@
-#include "FPlayerHighest.h"
+#include "BatchSimulator.h"
+#include "BoardFile.h"
+#include "BookPlayer.h"
+#include "CommandLine.h"
+#include "FPlayerMCTS.h"
 #include "FacilityGame.h"
-#include "NightHawk.h"
+#include "FacilityGameException.h"
+#include "LatencyStats.h"
+#include "Match.h"
+#include "MoveLog.h"
+#include "MoveLogWriter.h"
+#include "OpeningBook.h"
+#include "PlayerRegistry.h"
+#include "ScoreReduction.h"
+#include "SelfCheck.h"
+#include "Sprt.h"
+#include "ThreadPool.h"
+#include "Tournament.h"
 #include "enums.h"
 
-#include <utility>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
 
-int main() {
-  // FacilityGame game(10000, std::random_device()());
-  fmt::println("seed: {}", 3);
-  FacilityGame game(1000, 3);
+namespace {
 
+constexpr char const *USAGE = R"(usage:
+  facility_game [play] [--a NAME] [--b NAME] [--size N] [--seed N]
+                       [--board FILE] [--log FILE] [--latency FILE]
+                       [--book FILE] [--save-board FILE]
+  facility_game save-board [--size N] [--seed N] --out FILE
+  facility_game score --board FILE [--threads N]
+  facility_game tournament [--players NAME,...] [--sizes N,...]
+                           [--seeds FIRST:LAST|N,...] [--threads N]
+                           [--verbose] [--log FILE] [--latency FILE]
+                           [--move-time MS] [--book FILE]
+  facility_game book --out FILE [--sizes N,...] [--seeds FIRST:LAST|N,...]
+                     [--moves N] [--nodes N] [--threads N]
+  facility_game replay --log FILE [--threads N] [--verbose]
+  facility_game batch [--a NAME] [--b NAME] [--size N] [--games N]
+                      [--seed FIRST] [--threads N] [--verify N]
+  facility_game sweep [--a NAME] [--b NAME] [--size N] [--seed FIRST]
+                      [--max-games N] [--elo0 N] [--elo1 N] [--alpha P]
+                      [--beta P] [--threads N] [--verbose]
+  facility_game mcts-scaling [--size N] [--seed N] [--playouts N]
+                             [--threads N]
+  facility_game self-check [scores] [endgame] [large] [reduction]
+                           [--games N] [--seed N])";
+
+std::vector<std::string> parse_list(std::string_view text) {
+  std::vector<std::string> items;
+  while (true) {
+    auto const comma = text.find(',');
+    items.emplace_back(text.substr(0, comma));
+    if (comma == std::string_view::npos) {
+      return items;
+    }
+    text.remove_prefix(comma + 1);
+  }
+}
+
+std::vector<std::size_t> parse_numbers(std::string_view text) {
+  std::vector<std::size_t> numbers;
+  for (auto const &item : parse_list(text)) {
+    numbers.push_back(parse_number(item));
+  }
+  return numbers;
+}
+
+// either a list of numbers or a half-open range FIRST:LAST
+std::vector<std::size_t> parse_seeds(std::string_view text) {
+  auto const colon = text.find(':');
+  if (colon == std::string_view::npos) {
+    return parse_numbers(text);
+  }
+  std::size_t const first = parse_number(text.substr(0, colon));
+  std::size_t const last = parse_number(text.substr(colon + 1));
+  std::vector<std::size_t> seeds;
+  for (std::size_t seed = first; seed < last; ++seed) {
+    seeds.push_back(seed);
+  }
+  return seeds;
+}
+
+// plays a against b and then b against a on the same board, either generated
+// from the seed or loaded from a board file; the finished first game can be
+// saved as a board file, e.g. for the score subcommand
+int play(std::span<char const *const> args) {
+  std::string name_a = "Highest";
+  std::string name_b = "NightHawk";
+  std::size_t size = 1000;
+  std::size_t seed = 3;
+  std::string board;
+  std::string log;
+  std::string latency;
+  std::string book;
+  std::string save;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--a") {
+      name_a = option_value(args, idx);
+    } else if (arg == "--b") {
+      name_b = option_value(args, idx);
+    } else if (arg == "--size") {
+      size = parse_number(option_value(args, idx));
+    } else if (arg == "--seed") {
+      seed = parse_number(option_value(args, idx));
+    } else if (arg == "--board") {
+      board = option_value(args, idx);
+    } else if (arg == "--log") {
+      log = option_value(args, idx);
+    } else if (arg == "--latency") {
+      latency = option_value(args, idx);
+    } else if (arg == "--book") {
+      book = option_value(args, idx);
+    } else if (arg == "--save-board") {
+      save = option_value(args, idx);
+    } else {
+      unknown_option(arg);
+    }
+  }
+
+  std::shared_ptr<OpeningBook const> opening_book;
+  if (!book.empty()) {
+    opening_book = std::make_shared<OpeningBook const>(OpeningBook::load(book));
+  }
+  FacilityGame game =
+      board.empty() ? FacilityGame(size, seed) : load_board(board);
+  fmt::println("seed: {}", game.get_seed());
+  std::unique_ptr<MoveLogWriter> writer;
+  if (!log.empty()) {
+    writer = std::make_unique<MoveLogWriter>(log);
+  }
+  LatencyStats stats({name_a, name_b});
+  auto play_one = [&game, &writer, &stats, &opening_book, &save](
+                      std::string const &first,
+                      std::string const &second,
+                      std::size_t first_idx) {
+    auto player_a = find_player(first).create(Player::PLAYER_A);
+    auto player_b = find_player(second).create(Player::PLAYER_B);
+    if (opening_book) {
+      player_a = std::make_unique<BookPlayer>(
+          std::move(player_a),
+          Player::PLAYER_A,
+          opening_book);
+      player_b = std::make_unique<BookPlayer>(
+          std::move(player_b),
+          Player::PLAYER_B,
+          opening_book);
+    }
+    GameRecord record{
+        .size = game.get_num_nodes(),
+        .seed = game.get_seed(),
+        .player_a = first,
+        .player_b = second};
+    game.clear();
+    play_game(
+        game,
+        *player_a,
+        *player_b,
+        MoveTimer(
+            game,
+            &stats.get(first_idx),
+            &stats.get(1 - first_idx),
+            &record.times));
+    game.print();
+    if (writer) {
+      record.moves = game.get_moves();
+      writer->record(record);
+    }
+    if (!save.empty() && first_idx == 0) {
+      save_board(game, save);
+    }
+  };
+  play_one(name_a, name_b, 0);
+  play_one(name_b, name_a, 1);
+  if (writer) {
+    writer->close();
+  }
+  if (!latency.empty()) {
+    stats.print();
+    stats.save(latency);
+  }
+  return 0;
+}
+
+// writes a new board, without moves, to a board file
+int save_board(std::span<char const *const> args) {
+  std::size_t size = 1000;
+  std::size_t seed = 3;
+  std::string out;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--size") {
+      size = parse_number(option_value(args, idx));
+    } else if (arg == "--seed") {
+      seed = parse_number(option_value(args, idx));
+    } else if (arg == "--out") {
+      out = option_value(args, idx);
+    } else {
+      unknown_option(arg);
+    }
+  }
+  if (out.empty()) {
+    throw FacilityGameException("Missing --out");
+  }
+
+  save_board(FacilityGame(size, seed), out);
+  return 0;
+}
+
+// scores both players of a board file with the parallel reduction, and
+// checks the scores against the ones kept by the game
+int score(std::span<char const *const> args) {
+  std::string board;
+  std::size_t num_threads = ThreadPool::default_num_threads();
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--board") {
+      board = option_value(args, idx);
+    } else if (arg == "--threads") {
+      num_threads = parse_threads(option_value(args, idx));
+    } else {
+      unknown_option(arg);
+    }
+  }
+  if (board.empty()) {
+    throw FacilityGameException("Missing --board");
+  }
+
+  FacilityGame const game = load_board(board);
+  ThreadPool pool(num_threads);
+  auto const start = std::chrono::steady_clock::now();
+  auto const scores = compute_scores(game, pool);
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+  fmt::println(
+      "{} nodes scored in {:.3f} ms on {} threads",
+      game.get_num_nodes(),
+      elapsed.count() * 1e3,
+      pool.num_threads());
+  fmt::println("SCORE: PLAYER_A:{} PLAYER_B:{}", scores[0], scores[1]);
+  if (scores[0] != game.get_score(Player::PLAYER_A)
+      || scores[1] != game.get_score(Player::PLAYER_B)) {
+    fmt::println(
+        stderr,
+        "The reduction disagrees with the game: {} - {}",
+        game.get_score(Player::PLAYER_A),
+        game.get_score(Player::PLAYER_B));
+    return 1;
+  }
+  return 0;
+}
+
+int tournament(std::span<char const *const> args) {
+  TournamentConfig config;
+  for (auto const &entry : registered_players()) {
+    config.players.push_back(entry.name);
+  }
+  config.sizes = {100, 1000};
+  config.seeds = parse_seeds("0:10");
+
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--players") {
+      config.players = parse_list(option_value(args, idx));
+    } else if (arg == "--sizes") {
+      config.sizes = parse_numbers(option_value(args, idx));
+    } else if (arg == "--seeds") {
+      config.seeds = parse_seeds(option_value(args, idx));
+    } else if (arg == "--threads") {
+      config.num_threads = parse_threads(option_value(args, idx));
+    } else if (arg == "--verbose") {
+      config.verbose = true;
+    } else if (arg == "--log") {
+      config.log = option_value(args, idx);
+    } else if (arg == "--latency") {
+      config.latency = option_value(args, idx);
+    } else if (arg == "--move-time") {
+      config.move_time =
+          std::chrono::milliseconds(parse_number(option_value(args, idx)));
+    } else if (arg == "--book") {
+      config.book = option_value(args, idx);
+    } else {
+      unknown_option(arg);
+    }
+  }
+
+  Tournament tournament(std::move(config));
+  tournament.run();
+  tournament.print();
+  return 0;
+}
+
+// plays the first moves of every board with a deep alpha-beta search for
+// both players, and writes them as the lines of an opening book; the boards
+// are searched in parallel, and the book does not depend on the number of
+// threads
+int book(std::span<char const *const> args) {
+  std::vector<std::size_t> sizes{100, 1000};
+  std::vector<std::size_t> seeds = parse_seeds("0:10");
+  std::size_t num_moves = 8;
+  std::size_t max_nodes = 200000;
+  std::size_t num_threads = ThreadPool::default_num_threads();
+  std::string out;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--sizes") {
+      sizes = parse_numbers(option_value(args, idx));
+    } else if (arg == "--seeds") {
+      seeds = parse_seeds(option_value(args, idx));
+    } else if (arg == "--moves") {
+      num_moves = parse_number(option_value(args, idx));
+    } else if (arg == "--nodes") {
+      max_nodes = parse_number(option_value(args, idx));
+    } else if (arg == "--threads") {
+      num_threads = parse_threads(option_value(args, idx));
+    } else if (arg == "--out") {
+      out = option_value(args, idx);
+    } else {
+      unknown_option(arg);
+    }
+  }
+  if (out.empty()) {
+    throw FacilityGameException("Missing --out");
+  }
+
+  struct Line {
+    std::uint64_t hash{};
+    std::vector<std::size_t> moves;
+  };
+  std::vector<Line> lines(sizes.size() * seeds.size());
+  SearchLimits const limits{
+      .max_nodes = max_nodes,
+      .max_time = std::chrono::hours(1)};
+
+  auto const start = std::chrono::steady_clock::now();
   {
-    std::pair<FPlayerHighest, NightHawk> players{
-        Player::PLAYER_A,
-        Player::PLAYER_B};
+    ThreadPool pool(num_threads);
+    pool.parallel_for(lines.size(), [&](std::size_t idx) {
+      FacilityGame game(sizes[idx / seeds.size()], seeds[idx % seeds.size()]);
+      FPlayerAlphaBeta player_a(Player::PLAYER_A, limits);
+      FPlayerAlphaBeta player_b(Player::PLAYER_B, limits);
+      player_a.initialize(game);
+      player_b.initialize(game);
+      while (game.get_moves().size() < num_moves && !game.is_finished()) {
+        Player const player = game.get_player_to_move();
+        FPlayerAlphaBeta &current =
+            player == Player::PLAYER_A ? player_a : player_b;
+        game.append_move(player, current.next_move(game));
+      }
+      lines[idx] = {OpeningBook::board_hash(game), game.get_moves()};
+    });
+  }
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  OpeningBook opening_book;
+  for (auto &line : lines) {
+    opening_book.add(line.hash, std::move(line.moves));
+  }
+  opening_book.save(out);
+  fmt::println(
+      "{} lines of up to {} moves in {:.3f} sec on {} threads",
+      opening_book.size(),
+      num_moves,
+      elapsed.count(),
+      num_threads);
+  return 0;
+}
+
+// replays every game of a move log and checks its moves; the games are split
+// into chunks of consecutive games, and every chunk reuses its board while the
+// games share it, which they do in a tournament log
+int replay(std::span<char const *const> args) {
+  std::string log;
+  std::size_t num_threads = ThreadPool::default_num_threads();
+  bool verbose{};
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--log") {
+      log = option_value(args, idx);
+    } else if (arg == "--threads") {
+      num_threads = parse_threads(option_value(args, idx));
+    } else if (arg == "--verbose") {
+      verbose = true;
+    } else {
+      unknown_option(arg);
+    }
+  }
+  if (log.empty()) {
+    throw FacilityGameException("Missing --log");
+  }
 
-    players.first.initialize(game);
-    players.second.initialize(game);
+  struct Scores {
+    std::size_t score_a;
+    std::size_t score_b;
+  };
+  constexpr std::size_t CHUNKS_PER_THREAD = 16;
+  MoveLogReader const reader(log);
+  std::vector<Scores> scores(reader.size());
+  ThreadPool pool(num_threads);
+  std::size_t const num_chunks =
+      std::min(reader.size(), CHUNKS_PER_THREAD * pool.num_threads());
+  std::atomic<std::size_t> num_moves{0};
 
-    while (true) {
-      if (game.is_finished()) {
-        break;
+  auto const start = std::chrono::steady_clock::now();
+  pool.parallel_for(num_chunks, [&](std::size_t chunk) {
+    GameRecord record;
+    std::optional<FacilityGame> game;
+    std::size_t chunk_moves{};
+    for (std::size_t idx = chunk * reader.size() / num_chunks;
+         idx < (chunk + 1) * reader.size() / num_chunks;
+         ++idx) {
+      reader.read(idx, record);
+      if (game && game->get_num_nodes() == record.size
+          && game->get_seed() == record.seed) {
+        game->clear();
+      } else {
+        game.emplace(record.size, record.seed);
       }
-      game.append_move(Player::PLAYER_A, players.first.next_move(game));
-      if (game.is_finished()) {
-        break;
+      record.replay(*game);
+      scores[idx] = {
+          game->get_score(Player::PLAYER_A),
+          game->get_score(Player::PLAYER_B)};
+      chunk_moves += record.moves.size();
+    }
+    num_moves += chunk_moves;
+  });
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  if (verbose) {
+    GameRecord record;
+    for (std::size_t idx = 0; idx < reader.size(); ++idx) {
+      reader.read(idx, record);
+      fmt::println(
+          "size:{} seed:{} {} vs {}: {} - {}",
+          record.size,
+          record.seed,
+          record.player_a,
+          record.player_b,
+          scores[idx].score_a,
+          scores[idx].score_b);
+    }
+  }
+  fmt::println(
+      "{} games, {} moves, {} bytes in {:.3f} sec ({:.1f} games/sec) on {} "
+      "threads",
+      reader.size(),
+      num_moves.load(),
+      reader.num_bytes(),
+      elapsed.count(),
+      static_cast<double>(reader.size()) / elapsed.count(),
+      pool.num_threads());
+  return 0;
+}
+
+// plays a reference game of the batch simulator; Linear and Highest are
+// known at compile time, so their games run through play_match without
+// virtual calls, and the other players are looked up by name
+void play_reference(
+    FacilityGame &game,
+    std::string const &name_a,
+    std::string const &name_b) {
+  if (name_a == "Linear" && name_b == "Linear") {
+    play_match<FPlayerLinear, FPlayerLinear>(game);
+  } else if (name_a == "Linear" && name_b == "Highest") {
+    play_match<FPlayerLinear, FPlayerHighest>(game);
+  } else if (name_a == "Highest" && name_b == "Linear") {
+    play_match<FPlayerHighest, FPlayerLinear>(game);
+  } else if (name_a == "Highest" && name_b == "Highest") {
+    play_match<FPlayerHighest, FPlayerHighest>(game);
+  } else {
+    auto player_a = find_player(name_a).create(Player::PLAYER_A);
+    auto player_b = find_player(name_b).create(Player::PLAYER_B);
+    play_game(game, *player_a, *player_b);
+  }
+}
+
+// plays games between two of the simple players on the seeds FIRST,
+// FIRST + 1, ... with the batch simulator, and checks the first games
+// against FacilityGame and the players themselves
+int batch(std::span<char const *const> args) {
+  std::string name_a = "Highest";
+  std::string name_b = "Random";
+  std::size_t size = 100;
+  std::size_t num_games = 100000;
+  std::size_t first_seed = 0;
+  std::size_t num_threads = ThreadPool::default_num_threads();
+  std::size_t verify = 100;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--a") {
+      name_a = option_value(args, idx);
+    } else if (arg == "--b") {
+      name_b = option_value(args, idx);
+    } else if (arg == "--size") {
+      size = parse_number(option_value(args, idx));
+    } else if (arg == "--games") {
+      num_games = parse_number(option_value(args, idx));
+    } else if (arg == "--seed") {
+      first_seed = parse_number(option_value(args, idx));
+    } else if (arg == "--threads") {
+      num_threads = parse_threads(option_value(args, idx));
+    } else if (arg == "--verify") {
+      verify = parse_number(option_value(args, idx));
+    } else {
+      unknown_option(arg);
+    }
+  }
+  auto const policy_a = batch_policy(name_a);
+  auto const policy_b = batch_policy(name_b);
+  if (!policy_a || !policy_b) {
+    throw FacilityGameException(
+        "The batch simulator plays Linear, Random and Highest");
+  }
+
+  struct Totals {
+    std::size_t wins_a{};
+    std::size_t wins_b{};
+    std::size_t points_a{};
+    std::size_t points_b{};
+  };
+  // every worker plays every num_workers-th batch with its own simulator
+  constexpr std::size_t BATCH_GAMES = 1024;
+  std::size_t const num_batches = (num_games + BATCH_GAMES - 1) / BATCH_GAMES;
+  ThreadPool pool(num_threads);
+  std::size_t const num_workers = std::min(num_batches, pool.num_threads());
+  std::vector<Totals> totals(num_workers);
+  verify = std::min(verify, num_games);
+  std::vector<std::array<std::size_t, 2>> verify_scores(verify);
+
+  auto const start = std::chrono::steady_clock::now();
+  pool.parallel_for(num_workers, [&](std::size_t worker) {
+    BatchSimulator sim(size, BATCH_GAMES);
+    Totals &total = totals[worker];
+    for (std::size_t batch = worker; batch < num_batches;
+         batch += num_workers) {
+      std::size_t const first = batch * BATCH_GAMES;
+      std::size_t const count = std::min(BATCH_GAMES, num_games - first);
+      sim.reset(first_seed + first, count);
+      sim.run(*policy_a, *policy_b);
+      for (std::size_t game = 0; game < count; ++game) {
+        std::size_t const score_a = sim.get_score(game, Player::PLAYER_A);
+        std::size_t const score_b = sim.get_score(game, Player::PLAYER_B);
+        total.wins_a += score_a > score_b ? 1 : 0;
+        total.wins_b += score_b > score_a ? 1 : 0;
+        total.points_a += score_a;
+        total.points_b += score_b;
+        if (first + game < verify) {
+          verify_scores[first + game] = {score_a, score_b};
+        }
       }
-      game.append_move(Player::PLAYER_B, players.second.next_move(game));
     }
-    game.print();
+  });
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  for (std::size_t game = 0; game < verify; ++game) {
+    FacilityGame reference(size, first_seed + game);
+    play_reference(reference, name_a, name_b);
+    if (verify_scores[game][0] != reference.get_score(Player::PLAYER_A)
+        || verify_scores[game][1] != reference.get_score(Player::PLAYER_B)) {
+      throw FacilityGameException(
+          fmt::format(
+              "The batch simulator disagrees with FacilityGame on seed {}",
+              first_seed + game)
+              .c_str());
+    }
   }
 
-  game.clear();
-  {
-    std::pair<NightHawk, FPlayerHighest> players{
-        Player::PLAYER_A,
-        Player::PLAYER_B,
-    };
+  Totals total;
+  for (auto const &worker : totals) {
+    total.wins_a += worker.wins_a;
+    total.wins_b += worker.wins_b;
+    total.points_a += worker.points_a;
+    total.points_b += worker.points_b;
+  }
+  fmt::println(
+      "{} games in {:.3f} sec ({:.1f} games/sec) on {} threads, {} verified",
+      num_games,
+      elapsed.count(),
+      static_cast<double>(num_games) / elapsed.count(),
+      pool.num_threads(),
+      verify);
+  fmt::println(
+      "{} wins:{} points:{}\n{} wins:{} points:{}\ndraws:{}",
+      name_a,
+      total.wins_a,
+      total.points_a,
+      name_b,
+      total.wins_b,
+      total.points_b,
+      num_games - total.wins_a - total.wins_b);
+  return 0;
+}
+
+// plays a against b on the seeds FIRST, FIRST + 1, ... in both seat orders,
+// until the SPRT decides whether a is stronger than b, or max-games games
+// have been played; the two games of a seed are added to the test as a pair;
+// the seeds are played in parallel in rounds, and the pairs are added to the
+// test in seed order, so the result does not depend on the number of threads
+int sweep(std::span<char const *const> args) {
+  std::string name_a = "NightHawk";
+  std::string name_b = "Highest";
+  std::size_t size = 1000;
+  std::size_t first_seed = 0;
+  std::size_t max_games = 100000;
+  std::size_t num_threads = ThreadPool::default_num_threads();
+  bool verbose{};
+  SprtConfig config;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--a") {
+      name_a = option_value(args, idx);
+    } else if (arg == "--b") {
+      name_b = option_value(args, idx);
+    } else if (arg == "--size") {
+      size = parse_number(option_value(args, idx));
+    } else if (arg == "--seed") {
+      first_seed = parse_number(option_value(args, idx));
+    } else if (arg == "--max-games") {
+      max_games = parse_number(option_value(args, idx));
+    } else if (arg == "--elo0") {
+      config.elo0 = parse_real(option_value(args, idx));
+    } else if (arg == "--elo1") {
+      config.elo1 = parse_real(option_value(args, idx));
+    } else if (arg == "--alpha") {
+      config.alpha = parse_real(option_value(args, idx));
+    } else if (arg == "--beta") {
+      config.beta = parse_real(option_value(args, idx));
+    } else if (arg == "--threads") {
+      num_threads = parse_threads(option_value(args, idx));
+    } else if (arg == "--verbose") {
+      verbose = true;
+    } else {
+      unknown_option(arg);
+    }
+  }
+  Sprt sprt(config);
+  PlayerEntry const &entry_a = find_player(name_a);
+  PlayerEntry const &entry_b = find_player(name_b);
 
-    players.first.initialize(game);
-    players.second.initialize(game);
+  // the scores of a and b with a first, then with b first
+  using SeedScores = std::array<Sprt::GameScores, 2>;
+  auto play_seed = [&entry_a, &entry_b, size](std::size_t seed) {
+    SeedScores scores{};
+    FacilityGame game(size, seed);
+    for (std::size_t order = 0; order < 2; ++order) {
+      auto const &first = order == 0 ? entry_a : entry_b;
+      auto const &second = order == 0 ? entry_b : entry_a;
+      auto player_a = first.create(Player::PLAYER_A);
+      auto player_b = second.create(Player::PLAYER_B);
+      game.clear();
+      play_game(game, *player_a, *player_b);
+      std::size_t const score_first = game.get_score(Player::PLAYER_A);
+      std::size_t const score_second = game.get_score(Player::PLAYER_B);
+      scores[order] = order == 0 ? std::array{score_first, score_second}
+                                 : std::array{score_second, score_first};
+    }
+    return scores;
+  };
+
+  constexpr std::size_t SEEDS_PER_THREAD = 4;
+  RunningStats margins;
+  SprtResult result = SprtResult::CONTINUE;
+  std::size_t seed = first_seed;
+  ThreadPool pool(num_threads);
+  std::vector<SeedScores> round(SEEDS_PER_THREAD * pool.num_threads());
 
-    while (true) {
-      if (game.is_finished()) {
-        break;
+  auto const start = std::chrono::steady_clock::now();
+  while (result == SprtResult::CONTINUE && sprt.games() < max_games) {
+    pool.parallel_for(round.size(), [&](std::size_t idx) {
+      round[idx] = play_seed(seed + idx);
+    });
+    for (std::size_t idx = 0; idx < round.size()
+                              && result == SprtResult::CONTINUE
+                              && sprt.games() < max_games;
+         ++idx, ++seed) {
+      sprt.add_pair(round[idx][0], round[idx][1]);
+      for (auto const &[score_a, score_b] : round[idx]) {
+        margins.add(
+            static_cast<double>(score_a) - static_cast<double>(score_b));
       }
-      game.append_move(Player::PLAYER_A, players.first.next_move(game));
-      if (game.is_finished()) {
-        break;
+      if (verbose) {
+        fmt::println(
+            "seed:{} {} - {}, {} - {} llr:{:.3f}",
+            seed,
+            round[idx][0][0],
+            round[idx][0][1],
+            round[idx][1][0],
+            round[idx][1][1],
+            sprt.llr());
       }
-      game.append_move(Player::PLAYER_B, players.second.next_move(game));
+      result = sprt.result();
     }
-    game.print();
   }
-  // for (std::size_t seed = 0; seed < 10; ++seed) {
-  //   fmt::println("seed: {}", seed);
-  //   FacilityGame game(100, seed);
-
-  //  std::pair<FPlayerHighest, NightHawk> players{
-  //      Player::PLAYER_A,
-  //      Player::PLAYER_B};
-
-  //  players.first.initialize(game);
-  //  players.second.initialize(game);
-
-  //  while (true) {
-  //    if (game.is_finished()) {
-  //      break;
-  //    }
-  //    game.append_move(Player::PLAYER_A, players.first.next_move(game));
-  //    if (game.is_finished()) {
-  //      break;
-  //    }
-  //    game.append_move(Player::PLAYER_B, players.second.next_move(game));
-  //  }
-  //  game.print();
-  //}
+  std::chrono::duration<double> const elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  fmt::println(
+      "{} games on seeds {}:{} in {:.3f} sec on {} threads",
+      sprt.games(),
+      first_seed,
+      seed,
+      elapsed.count(),
+      pool.num_threads());
+  fmt::println(
+      "{} vs {}: wins:{} draws:{} losses:{} score:{:.3f} elo:{:.1f}",
+      name_a,
+      name_b,
+      sprt.wins(),
+      sprt.draws(),
+      sprt.losses(),
+      sprt.score(),
+      sprt.elo());
+  fmt::println(
+      "pairs by points of {}: 0:{} 0.5:{} 1:{} 1.5:{} 2:{}",
+      name_a,
+      sprt.pairs_with(0),
+      sprt.pairs_with(1),
+      sprt.pairs_with(2),
+      sprt.pairs_with(3),
+      sprt.pairs_with(4));
+  fmt::println(
+      "margin: {:.1f} +- {:.1f} points per game (95%)",
+      margins.mean(),
+      margins.ci95());
+  fmt::println(
+      "SPRT elo0:{} elo1:{} alpha:{} beta:{}: llr:{:.3f} [{:.3f}, {:.3f}]",
+      config.elo0,
+      config.elo1,
+      config.alpha,
+      config.beta,
+      sprt.llr(),
+      sprt.lower_bound(),
+      sprt.upper_bound());
+  switch (result) {
+  case SprtResult::ACCEPT_H1: {
+    fmt::println("H1 accepted: {} is stronger than {}", name_a, name_b);
+    break;
+  }
+  case SprtResult::ACCEPT_H0: {
+    fmt::println("H0 accepted: {} is not stronger than {}", name_a, name_b);
+    break;
+  }
+  case SprtResult::CONTINUE: {
+    fmt::println("No decision after {} games", sprt.games());
+    break;
+  }
+  }
   return 0;
 }
+
+// the playouts/sec of the first MCTS move for 1 to N threads, with the same
+// total number of playouts
+int mcts_scaling(std::span<char const *const> args) {
+  std::size_t size = 1000;
+  std::size_t seed = 3;
+  std::size_t playouts = 100000;
+  std::size_t max_threads = ThreadPool::default_num_threads();
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--size") {
+      size = parse_number(option_value(args, idx));
+    } else if (arg == "--seed") {
+      seed = parse_number(option_value(args, idx));
+    } else if (arg == "--playouts") {
+      playouts = parse_number(option_value(args, idx));
+    } else if (arg == "--threads") {
+      max_threads = parse_threads(option_value(args, idx));
+    } else {
+      unknown_option(arg);
+    }
+  }
+
+  FacilityGame game(size, seed);
+  double base{};
+  for (std::size_t num_threads = 1; num_threads <= max_threads;
+       ++num_threads) {
+    FPlayerMCTS player(
+        Player::PLAYER_A,
+        MCTSLimits{
+            .num_threads = num_threads,
+            .max_playouts = playouts,
+            .max_time = std::chrono::hours(1)});
+    player.initialize(game);
+    (void)player.next_move(game);
+    double const rate = player.get_stats().playouts_per_sec();
+    if (num_threads == 1) {
+      base = rate;
+    }
+    fmt::println(
+        "threads:{} playouts:{} playouts/sec:{:.0f} speedup:{:.2f}",
+        num_threads,
+        player.get_stats().playouts,
+        rate,
+        rate / base);
+  }
+  return 0;
+}
+
+// runs the named randomized checks of the engine, all of them by default;
+// ctest runs each one on its own
+int run_self_checks(std::span<char const *const> args) {
+  std::vector<std::string> checks;
+  std::size_t num_games = 1000;
+  std::size_t seed = 0;
+  for (std::size_t idx = 0; idx < args.size(); ++idx) {
+    std::string_view const arg = args[idx];
+    if (arg == "--games") {
+      num_games = parse_number(option_value(args, idx));
+    } else if (arg == "--seed") {
+      seed = parse_number(option_value(args, idx));
+    } else if (arg == "scores" || arg == "endgame" || arg == "large"
+               || arg == "reduction") {
+      checks.emplace_back(arg);
+    } else {
+      unknown_option(arg);
+    }
+  }
+  if (checks.empty()) {
+    checks = {"scores", "endgame", "large", "reduction"};
+  }
+
+  for (auto const &check : checks) {
+    if (check == "scores") {
+      self_check::check_scores(num_games, seed);
+    } else if (check == "endgame") {
+      self_check::check_endgame(num_games, seed);
+    } else if (check == "large") {
+      self_check::check_large(seed);
+    } else if (check == "reduction") {
+      self_check::check_reduction(num_games, seed);
+    }
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char const *const *argv) {
+  std::span<char const *const> args(
+      argv + 1,
+      static_cast<std::size_t>(argc - 1));
+  try {
+    if (!args.empty() && std::string_view(args[0]) == "tournament") {
+      return tournament(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "save-board") {
+      return save_board(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "score") {
+      return score(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "book") {
+      return book(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "replay") {
+      return replay(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "batch") {
+      return batch(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "sweep") {
+      return sweep(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "mcts-scaling") {
+      return mcts_scaling(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "self-check") {
+      return run_self_checks(args.subspan(1));
+    }
+    if (!args.empty() && std::string_view(args[0]) == "play") {
+      return play(args.subspan(1));
+    }
+    return play(args);
+  } catch (FacilityGameException const &ex) {
+    fmt::println(stderr, "{}\n{}", ex.what(), USAGE);
+    std::string players;
+    for (auto const &entry : registered_players()) {
+      players += players.empty() ? entry.name : ", " + entry.name;
+    }
+    fmt::println(
+        stderr,
+        "players: {}, and {} in a tournament with --move-time",
+        players,
+        slow_player().name);
+    return 1;
+  }
+}
@@ -0,0 +1,5 @@
+cmake -S . -B build-bench -DCMAKE_BUILD_TYPE=Release
+cmake --build build-bench --target facility_bench
+
+# one file per commit, to compare against a baseline
+build-bench/facility_bench --format csv "$@" > "bench-$(git rev-parse --short HEAD).csv"